@@ -0,0 +1,281 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+#include "../mbr.h"
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif //ARROW_C_DATA_INTERFACE
+
+#ifndef MBR_ARROW_H
+#define MBR_ARROW_H
+namespace mbr {
+    ///Zero copy view of a box column held in Arrow buffers, either a
+    ///struct of four float64 children (minx, miny, maxx, maxy) or a
+    ///fixed size list<float64, 4> of interleaved bounds
+    struct BoxColumn {
+        const double *minx = nullptr;
+        const double *miny = nullptr;
+        const double *maxx = nullptr;
+        const double *maxy = nullptr;
+        std::size_t stride = 1;
+        std::size_t length = 0;
+        const uint8_t *validity = nullptr;
+        std::size_t validity_offset = 0;
+
+        [[nodiscard]] std::size_t size() const { return length; }
+
+        [[nodiscard]] bool is_valid(std::size_t i) const {
+            if (!validity) {
+                return true;
+            }
+            auto bit = validity_offset + i;
+            return (validity[bit >> 3] >> (bit & 7)) & 1;
+        }
+
+        MBR<double> operator[](std::size_t i) const {
+            auto k = i * stride;
+            return {minx[k], miny[k], maxx[k], maxy[k], true};
+        }
+
+        ///Boxes as a contiguous MBR array when the column is an
+        ///interleaved list without nulls, nullptr otherwise
+        [[nodiscard]] const MBR<double> *boxes() const {
+            if (stride != 4 || validity) {
+                return nullptr;
+            }
+            return reinterpret_cast<const MBR<double> *>(minx);
+        }
+
+        ///Bounds of all valid boxes, nullopt if there are none
+        [[nodiscard]] std::optional<MBR<double>> bounds() const {
+            std::optional<MBR<double>> out;
+            for (std::size_t i = 0; i < length; i++) {
+                if (!is_valid(i)) {
+                    continue;
+                }
+                if (out) {
+                    out->expand_to_include((*this)[i]);
+                }
+                else {
+                    out = (*this)[i];
+                }
+            }
+            return out;
+        }
+
+        ///Appends the positions of valid boxes that intersect query
+        void search(const MBR<double> &query, std::vector<uint64_t> &out) const {
+            for (std::size_t i = 0; i < length; i++) {
+                auto k = i * stride;
+                auto hit = !(minx[k] > query.maxx || maxx[k] < query.minx ||
+                             miny[k] > query.maxy || maxy[k] < query.miny);
+                if (hit && is_valid(i)) {
+                    out.push_back(i);
+                }
+            }
+        }
+    };
+
+    namespace arrow {
+        inline bool is_float64(const ArrowSchema *schema, const ArrowArray *array) {
+            return std::strcmp(schema->format, "g") == 0 &&
+                   array->n_buffers == 2 && array->null_count == 0;
+        }
+
+        inline const double *values(const ArrowArray *array, int64_t offset) {
+            return static_cast<const double *>(array->buffers[1]) + array->offset + offset;
+        }
+
+        ///Owned buffers behind one exported array. Children are arrays
+        ///of their own, owning their buffers through their own private
+        ///data, so a consumer may move one out and release it separately.
+        struct Exported {
+            std::vector<MBR<double>> boxes;
+            std::vector<double> values;
+            std::vector<const void *> buffers;
+            std::vector<ArrowArray *> children;
+        };
+
+        struct ExportedSchema {
+            std::vector<ArrowSchema *> children;
+        };
+
+        ///Releases the children still in place, then the array itself
+        inline void release_array(ArrowArray *array) {
+            auto priv = static_cast<Exported *>(array->private_data);
+            for (auto child : priv->children) {
+                if (child->release) {
+                    child->release(child);
+                }
+                delete child;
+            }
+            delete priv;
+            array->release = nullptr;
+        }
+
+        inline void release_schema(ArrowSchema *schema) {
+            auto priv = static_cast<ExportedSchema *>(schema->private_data);
+            if (priv) {
+                for (auto child : priv->children) {
+                    if (child->release) {
+                        child->release(child);
+                    }
+                    delete child;
+                }
+                delete priv;
+            }
+            schema->release = nullptr;
+        }
+
+        inline void export_schema(ArrowSchema *out, const char *format,
+                                  const std::vector<const char *> &names) {
+            auto priv = new ExportedSchema();
+            for (auto name : names) {
+                priv->children.push_back(new ArrowSchema{
+                        "g", name, nullptr, 0, 0, nullptr, nullptr, release_schema, nullptr,
+                });
+            }
+            *out = ArrowSchema{
+                    format, "", nullptr, 0, static_cast<int64_t>(names.size()),
+                    priv->children.data(), nullptr, release_schema, priv,
+            };
+        }
+
+        ///Float64 array of length values at data, owned by priv
+        inline ArrowArray *export_values(Exported *priv, const void *data, int64_t length) {
+            priv->buffers = {nullptr, data};
+            return new ArrowArray{
+                    length, 0, 0, 2, 0, priv->buffers.data(), nullptr, nullptr, release_array, priv,
+            };
+        }
+
+        ///Fills a parent array of length rows, without nulls, over the
+        ///children already in priv
+        inline void export_parent(ArrowArray *out, Exported *priv, int64_t length) {
+            priv->buffers = {nullptr};
+            *out = ArrowArray{
+                    length, 0, 0, 1, static_cast<int64_t>(priv->children.size()), priv->buffers.data(),
+                    priv->children.data(), nullptr, release_array, priv,
+            };
+        }
+    }
+
+    ///Imports a box column without copying; the producer keeps ownership
+    ///and must outlive the returned view. Nullopt if the layout is not a
+    ///struct of four float64 or a fixed size list<float64, 4>.
+    inline std::optional<BoxColumn> import_boxes(const ArrowSchema *schema, const ArrowArray *array) {
+        if (!schema || !array || !schema->format || !array->release || array->n_buffers < 1) {
+            return std::nullopt;
+        }
+        BoxColumn col;
+        col.length = static_cast<std::size_t>(array->length);
+        col.validity_offset = static_cast<std::size_t>(array->offset);
+        if (array->null_count != 0) {
+            col.validity = static_cast<const uint8_t *>(array->buffers[0]);
+        }
+        auto offset = array->offset;
+
+        if (std::strcmp(schema->format, "+w:4") == 0) {
+            if (schema->n_children != 1 || array->n_children != 1 ||
+                !arrow::is_float64(schema->children[0], array->children[0])) {
+                return std::nullopt;
+            }
+            auto values = arrow::values(array->children[0], 4 * offset);
+            col.minx = values;
+            col.miny = values + 1;
+            col.maxx = values + 2;
+            col.maxy = values + 3;
+            col.stride = 4;
+            return col;
+        }
+        if (std::strcmp(schema->format, "+s") == 0) {
+            if (schema->n_children != 4 || array->n_children != 4) {
+                return std::nullopt;
+            }
+            const double *cols[4];
+            for (int i = 0; i < 4; i++) {
+                if (!arrow::is_float64(schema->children[i], array->children[i])) {
+                    return std::nullopt;
+                }
+                cols[i] = arrow::values(array->children[i], offset);
+            }
+            col.minx = cols[0];
+            col.miny = cols[1];
+            col.maxx = cols[2];
+            col.maxy = cols[3];
+            col.stride = 1;
+            return col;
+        }
+        return std::nullopt;
+    }
+
+    ///Exports boxes as a fixed size list<float64, 4>, moving the vector
+    ///into the exported array without copying
+    inline void export_boxes(std::vector<MBR<double>> boxes, ArrowSchema *schema, ArrowArray *array) {
+        auto n = static_cast<int64_t>(boxes.size());
+        auto values = new arrow::Exported();
+        values->boxes = std::move(boxes);
+        auto priv = new arrow::Exported();
+        priv->children.push_back(arrow::export_values(values, values->boxes.data(), 4 * n));
+        arrow::export_parent(array, priv, n);
+        arrow::export_schema(schema, "+w:4", {"item"});
+    }
+
+    ///Exports four bound columns as a struct of float64 children
+    ///minx, miny, maxx, maxy, moving the vectors without copying;
+    ///throws std::invalid_argument if their lengths differ
+    inline void export_box_columns(std::vector<double> minx, std::vector<double> miny,
+                                   std::vector<double> maxx, std::vector<double> maxy,
+                                   ArrowSchema *schema, ArrowArray *array) {
+        auto n = minx.size();
+        if (miny.size() != n || maxx.size() != n || maxy.size() != n) {
+            throw std::invalid_argument("box columns differ in length");
+        }
+        auto priv = new arrow::Exported();
+        for (auto column : {&minx, &miny, &maxx, &maxy}) {
+            auto values = new arrow::Exported();
+            values->values = std::move(*column);
+            priv->children.push_back(arrow::export_values(values, values->values.data(),
+                                                          static_cast<int64_t>(n)));
+        }
+        arrow::export_parent(array, priv, static_cast<int64_t>(n));
+        arrow::export_schema(schema, "+s", {"minx", "miny", "maxx", "maxy"});
+    }
+}
+#endif //MBR_ARROW_H
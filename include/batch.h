@@ -0,0 +1,209 @@
+#include <vector>
+
+#include "index.h"
+#include "pool.h"
+
+#ifndef MBR_BATCH_H
+#define MBR_BATCH_H
+namespace mbr {
+    ///Results of a batch of queries in compressed sparse row form:
+    ///hits of query i are indices[offsets[i], offsets[i + 1])
+    struct Csr {
+        std::vector<uint64_t> offsets;
+        std::vector<uint64_t> indices;
+
+        [[nodiscard]] std::size_t size() const {
+            return offsets.empty() ? 0 : offsets.size() - 1;
+        }
+
+        [[nodiscard]] std::size_t count(std::size_t i) const {
+            return offsets[i + 1] - offsets[i];
+        }
+
+        [[nodiscard]] const uint64_t *begin(std::size_t i) const {
+            return indices.data() + offsets[i];
+        }
+
+        [[nodiscard]] const uint64_t *end(std::size_t i) const {
+            return indices.data() + offsets[i + 1];
+        }
+    };
+
+    namespace batch {
+        ///Where the hits of a query start in the buffer of a worker
+        struct Span {
+            std::size_t worker;
+            std::size_t start;
+        };
+
+        ///Packs per worker hit buffers as Csr; counts[i + 1] holds the
+        ///number of hits of query i and is turned into offsets
+        inline Csr pack(std::vector<uint64_t> counts, const std::vector<Span> &spans,
+                        const std::vector<std::vector<uint64_t>> &buffers,
+                        ThreadPool &pool, std::size_t grain) {
+            auto n = spans.size();
+            Csr out;
+            out.offsets = std::move(counts);
+            for (std::size_t i = 0; i < n; i++) {
+                out.offsets[i + 1] += out.offsets[i];
+            }
+            out.indices.resize(out.offsets[n]);
+            pool.parallel_for(n, grain, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (auto i = begin; i < end; i++) {
+                    auto src = buffers[spans[i].worker].data() + spans[i].start;
+                    std::copy(src, src + out.count(i), out.indices.data() + out.offsets[i]);
+                }
+            });
+            return out;
+        }
+
+        ///Runs query(i, out) for every query on the pool, each worker
+        ///appending into its own buffer, then packs the hits as Csr
+        template<typename Query>
+        Csr run(std::size_t n, ThreadPool &pool, std::size_t grain, Query &&query) {
+            std::vector<std::vector<uint64_t>> buffers(pool.size());
+            std::vector<Span> spans(n);
+            std::vector<uint64_t> counts(n + 1, 0);
+            pool.parallel_for(n, grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+                auto &buf = buffers[worker];
+                for (auto i = begin; i < end; i++) {
+                    spans[i] = {worker, buf.size()};
+                    query(i, buf);
+                    counts[i + 1] = buf.size() - spans[i].start;
+                }
+            });
+            return pack(std::move(counts), spans, buffers, pool, grain);
+        }
+
+        ///Prefetches the boxes and indices of the node starting at pos
+        template<typename T>
+        void prefetch(const IndexView<T> &index, uint64_t pos) {
+            auto boxes = reinterpret_cast<const char *>(index.boxes + pos);
+            auto ids = reinterpret_cast<const char *>(index.indices + pos);
+            for (std::size_t b = 0; b < index.node_size * sizeof(MBR<T>); b += 64) {
+                __builtin_prefetch(boxes + b);
+            }
+            for (std::size_t b = 0; b < index.node_size * sizeof(uint64_t); b += 64) {
+                __builtin_prefetch(ids + b);
+            }
+        }
+    }
+
+    ///Window queries spread over the pool, hits of windows[i] in row i
+    template<typename T>
+    Csr query_many(const IndexView<T> &index, const MBR<T> *windows, std::size_t n,
+                   ThreadPool &pool, std::size_t grain = 64) {
+        return batch::run(n, pool, grain, [&](std::size_t i, std::vector<uint64_t> &out) {
+            index.search(windows[i], out);
+        });
+    }
+
+    template<typename T>
+    Csr query_many(const Index<T> &index, const std::vector<MBR<T>> &windows,
+                   ThreadPool &pool, std::size_t grain = 64) {
+        return query_many(index.view(), windows.data(), windows.size(), pool, grain);
+    }
+
+    ///Window queries traversed in interleaved groups: queries are sorted by
+    ///the Hilbert value of their center, then each worker keeps `group`
+    ///traversals in flight and steps them round robin, prefetching the
+    ///next node of a traversal before moving on to the others so memory
+    ///latency overlaps with the work on the rest of the group.
+    ///Rows of the result follow the order of windows.
+    template<typename T>
+    Csr query_many_interleaved(const IndexView<T> &index, const MBR<T> *windows, std::size_t n,
+                               ThreadPool &pool, std::size_t group = 8, std::size_t grain = 256) {
+        if (index.empty()) {
+            return Csr{std::vector<uint64_t>(n + 1, 0), {}};
+        }
+        auto extent = index.bounds();
+        std::vector<std::pair<uint32_t, uint64_t>> order(n);
+        for (std::size_t i = 0; i < n; i++) {
+            order[i] = {hilbert(windows[i], extent), i};
+        }
+        std::sort(order.begin(), order.end());
+
+        struct Traversal {
+            uint64_t query;
+            uint64_t node;
+            std::vector<uint64_t> stack;
+            std::vector<uint64_t> hits;
+        };
+        group = std::max<std::size_t>(group, 1);
+        std::vector<std::vector<uint64_t>> buffers(pool.size());
+        std::vector<batch::Span> spans(n);
+        std::vector<uint64_t> counts(n + 1, 0);
+        pool.parallel_for(n, grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+            auto &buf = buffers[worker];
+            std::vector<Traversal> slots(std::min(group, end - begin));
+            auto next = begin;
+            for (auto &t : slots) {
+                t.query = order[next++].second;
+                t.node = index.num_nodes - 1;
+            }
+            auto active = slots.size();
+            while (active > 0) {
+                for (auto &t : slots) {
+                    if (t.query == n) {
+                        continue;
+                    }
+                    auto &query = windows[t.query];
+                    auto node = t.node;
+                    auto last = std::min(node + index.node_size, index.level_end(node));
+                    for (auto pos = node; pos < last; pos++) {
+                        if (!query.intersects(index.boxes[pos])) {
+                            continue;
+                        }
+                        if (node < index.num_items) {
+                            t.hits.push_back(index.indices[pos]);
+                        }
+                        else {
+                            t.stack.push_back(index.indices[pos]);
+                        }
+                    }
+                    if (!t.stack.empty()) {
+                        t.node = t.stack.back();
+                        t.stack.pop_back();
+                        batch::prefetch(index, t.node);
+                        continue;
+                    }
+                    spans[t.query] = {worker, buf.size()};
+                    counts[t.query + 1] = t.hits.size();
+                    buf.insert(buf.end(), t.hits.begin(), t.hits.end());
+                    t.hits.clear();
+                    if (next < end) {
+                        t.query = order[next++].second;
+                        t.node = index.num_nodes - 1;
+                    }
+                    else {
+                        t.query = n;
+                        active--;
+                    }
+                }
+            }
+        });
+        return batch::pack(std::move(counts), spans, buffers, pool, grain);
+    }
+
+    template<typename T>
+    Csr query_many_interleaved(const Index<T> &index, const std::vector<MBR<T>> &windows,
+                               ThreadPool &pool, std::size_t group = 8, std::size_t grain = 256) {
+        return query_many_interleaved(index.view(), windows.data(), windows.size(), pool, group, grain);
+    }
+
+    ///k nearest neighbour queries spread over the pool, nearest first in row i
+    template<typename T>
+    Csr knn_many(const IndexView<T> &index, const MBR<T> *queries, std::size_t n, std::size_t k,
+                 ThreadPool &pool, std::size_t grain = 64) {
+        return batch::run(n, pool, grain, [&](std::size_t i, std::vector<uint64_t> &out) {
+            index.knn(queries[i], k, out);
+        });
+    }
+
+    template<typename T>
+    Csr knn_many(const Index<T> &index, const std::vector<MBR<T>> &queries, std::size_t k,
+                 ThreadPool &pool, std::size_t grain = 64) {
+        return knn_many(index.view(), queries.data(), queries.size(), k, pool, grain);
+    }
+}
+#endif //MBR_BATCH_H
@@ -0,0 +1,156 @@
+#include <limits>
+#include <vector>
+#include <optional>
+#include <type_traits>
+
+#include "../mbr.h"
+#include "pool.h"
+
+#ifndef MBR_BOUNDS_H
+#define MBR_BOUNDS_H
+namespace mbr {
+    namespace bounds {
+        ///Width of the vector registers min / max run on
+#ifdef __AVX__
+        constexpr std::size_t VECTOR_BYTES = 32;
+#else
+        constexpr std::size_t VECTOR_BYTES = 16;
+#endif
+
+        ///Min / max accumulators as vectors of lanes, so a scan has no
+        ///dependency between consecutive points and each step is one
+        ///packed compare and select per bound
+        template<typename T>
+        struct alignas(64) Acc {
+            static_assert(std::is_arithmetic<T>::value && VECTOR_BYTES % sizeof(T) == 0);
+
+            static constexpr std::size_t LANES = VECTOR_BYTES / sizeof(T);
+            static constexpr T LOW = std::numeric_limits<T>::has_infinity ?
+                                     -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+            static constexpr T HIGH = std::numeric_limits<T>::has_infinity ?
+                                      std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+
+            typedef T Vec __attribute__((vector_size(VECTOR_BYTES)));
+
+            Vec minx;
+            Vec miny;
+            Vec maxx;
+            Vec maxy;
+
+            Acc() {
+                for (std::size_t j = 0; j < LANES; j++) {
+                    minx[j] = miny[j] = HIGH;
+                    maxx[j] = maxy[j] = LOW;
+                }
+            }
+
+            ///Adds points [begin, end) read through x(i) and y(i);
+            ///NaN coordinates never compare and are skipped
+            template<typename X, typename Y>
+            void scan(std::size_t begin, std::size_t end, X &&x, Y &&y) {
+                auto lx = minx, ly = miny, hx = maxx, hy = maxy;
+                auto i = begin;
+                for (; i + LANES <= end; i += LANES) {
+                    Vec vx{}, vy{};
+                    for (std::size_t j = 0; j < LANES; j++) {
+                        vx[j] = x(i + j);
+                        vy[j] = y(i + j);
+                    }
+                    lx = vx < lx ? vx : lx;
+                    hx = vx > hx ? vx : hx;
+                    ly = vy < ly ? vy : ly;
+                    hy = vy > hy ? vy : hy;
+                }
+                for (; i < end; i++) {
+                    T vx = x(i), vy = y(i);
+                    lx[0] = vx < lx[0] ? vx : lx[0];
+                    hx[0] = vx > hx[0] ? vx : hx[0];
+                    ly[0] = vy < ly[0] ? vy : ly[0];
+                    hy[0] = vy > hy[0] ? vy : hy[0];
+                }
+                minx = lx, miny = ly, maxx = hx, maxy = hy;
+            }
+
+            void merge(const Acc &other) {
+                minx = other.minx < minx ? other.minx : minx;
+                miny = other.miny < miny ? other.miny : miny;
+                maxx = other.maxx > maxx ? other.maxx : maxx;
+                maxy = other.maxy > maxy ? other.maxy : maxy;
+            }
+
+            ///Envelope of the points seen, empty if there were none
+            std::optional<MBR<T>> result() const {
+                MBR<T> box{minx[0], miny[0], maxx[0], maxy[0], true};
+                for (std::size_t j = 1; j < LANES; j++) {
+                    box.minx = minx[j] < box.minx ? minx[j] : box.minx;
+                    box.miny = miny[j] < box.miny ? miny[j] : box.miny;
+                    box.maxx = maxx[j] > box.maxx ? maxx[j] : box.maxx;
+                    box.maxy = maxy[j] > box.maxy ? maxy[j] : box.maxy;
+                }
+                if (box.minx > box.maxx || box.miny > box.maxy) {
+                    return std::nullopt;
+                }
+                return box;
+            }
+        };
+
+        ///Scans [0, n) across pool, one accumulator per worker
+        template<typename T, typename X, typename Y>
+        std::optional<MBR<T>> parallel(std::size_t n, ThreadPool &pool, std::size_t grain, X &&x, Y &&y) {
+            std::vector<Acc<T>> parts(pool.size());
+            pool.parallel_for(n, grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+                parts[worker].scan(begin, end, x, y);
+            });
+            for (std::size_t w = 1; w < parts.size(); w++) {
+                parts[0].merge(parts[w]);
+            }
+            return parts[0].result();
+        }
+    }
+
+    ///Envelope of n points, empty if there are no points
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const Pt<T> *pts, std::size_t n) {
+        bounds::Acc<T> acc;
+        acc.scan(0, n, [&](std::size_t i) { return pts[i].x; }, [&](std::size_t i) { return pts[i].y; });
+        return acc.result();
+    }
+
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const std::vector<Pt<T>> &pts) {
+        return bounds_of(pts.data(), pts.size());
+    }
+
+    ///Envelope of n points stored as separate x and y columns
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const T *xs, const T *ys, std::size_t n) {
+        bounds::Acc<T> acc;
+        acc.scan(0, n, [&](std::size_t i) { return xs[i]; }, [&](std::size_t i) { return ys[i]; });
+        return acc.result();
+    }
+
+    ///Envelope of n points, chunks of grain points scanned across pool
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const Pt<T> *pts, std::size_t n,
+                                    ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return bounds::parallel<T>(n, pool, grain,
+                                   [&](std::size_t i) { return pts[i].x; },
+                                   [&](std::size_t i) { return pts[i].y; });
+    }
+
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const std::vector<Pt<T>> &pts,
+                                    ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return bounds_of(pts.data(), pts.size(), pool, grain);
+    }
+
+    ///Envelope of n points in x and y columns, scanned across pool
+    template<typename T>
+    std::optional<MBR<T>> bounds_of(const T *xs, const T *ys, std::size_t n,
+                                    ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return bounds::parallel<T>(n, pool, grain,
+                                   [&](std::size_t i) { return xs[i]; },
+                                   [&](std::size_t i) { return ys[i]; });
+    }
+}
+#endif //MBR_BOUNDS_H
@@ -0,0 +1,157 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "index.h"
+
+#ifndef MBR_CHAINS_H
+#define MBR_CHAINS_H
+namespace mbr {
+    ///Run of polyline vertices [first, last] along which x and y each
+    ///never change direction, so segments are ordered along x
+    template<typename T>
+    struct MonotoneChain {
+        std::size_t first;
+        std::size_t last;
+        MBR<T> box;
+        ///+1 if x never decreases along the chain, -1 if it never increases
+        int xdir;
+    };
+
+    namespace chains {
+        template<typename T>
+        int sign(T v) {
+            return (T{0} < v) - (v < T{0});
+        }
+
+        ///Orientation of c relative to a b : > 0 left, < 0 right, 0 collinear
+        template<typename T>
+        double orient(const Pt<T> &a, const Pt<T> &b, const Pt<T> &c) {
+            return (static_cast<double>(b.x) - a.x) * (static_cast<double>(c.y) - a.y) -
+                   (static_cast<double>(b.y) - a.y) * (static_cast<double>(c.x) - a.x);
+        }
+
+        ///Exact test of segments a b and c d, touching counts
+        template<typename T>
+        bool segments_cross(const Pt<T> &a, const Pt<T> &b, const Pt<T> &c, const Pt<T> &d) {
+            if (!MBR<T>(a, b).intersects(MBR<T>(c, d))) {
+                return false;
+            }
+            auto d1 = orient(a, b, c), d2 = orient(a, b, d);
+            auto d3 = orient(c, d, a), d4 = orient(c, d, b);
+            //all four collinear, overlap is settled by the envelope test above;
+            //d1 and d2 alone vanish for any c d when a b is a single point
+            if (d1 == 0 && d2 == 0 && d3 == 0 && d4 == 0) {
+                return true;
+            }
+            return ((d1 <= 0 && d2 >= 0) || (d1 >= 0 && d2 <= 0)) &&
+                   ((d3 <= 0 && d4 >= 0) || (d3 >= 0 && d4 <= 0));
+        }
+    }
+
+    ///Segment index over a long polyline : the polyline is split into
+    ///monotone chains of at most max_segments segments, a packed index
+    ///holds the chain boxes, and inside a chain the segments overlapping
+    ///a window along x are found by binary search. Segment i joins
+    ///points[i] and points[i + 1].
+    template<typename T>
+    struct ChainIndex {
+        std::vector<Pt<T>> points;
+        std::vector<MonotoneChain<T>> chains;
+        Index<T> index;
+
+        ChainIndex() = default;
+
+        explicit ChainIndex(const std::vector<Pt<T>> &pts, std::size_t max_segments = 32, uint64_t node_size = 16) :
+                ChainIndex(pts.data(), pts.size(), max_segments, node_size) {}
+
+        ChainIndex(const Pt<T> *pts, std::size_t n, std::size_t max_segments = 32, uint64_t node_size = 16) :
+                points(pts, pts + n) {
+            max_segments = std::max<std::size_t>(max_segments, 1);
+            std::size_t first = 0;
+            while (first + 1 < n) {
+                int xdir = 0, ydir = 0;
+                auto last = first;
+                while (last + 1 < n && last - first < max_segments) {
+                    auto sx = chains::sign(pts[last + 1].x - pts[last].x);
+                    auto sy = chains::sign(pts[last + 1].y - pts[last].y);
+                    if ((sx != 0 && xdir != 0 && sx != xdir) || (sy != 0 && ydir != 0 && sy != ydir)) {
+                        break;
+                    }
+                    xdir = sx != 0 ? sx : xdir;
+                    ydir = sy != 0 ? sy : ydir;
+                    last++;
+                }
+                chains.push_back({first, last, MBR<T>(pts[first], pts[last]), xdir < 0 ? -1 : 1});
+                first = last;
+            }
+            std::vector<MBR<T>> boxes(chains.size());
+            for (std::size_t c = 0; c < chains.size(); c++) {
+                boxes[c] = chains[c].box;
+            }
+            index = Index<T>(boxes, node_size);
+        }
+
+        ///Number of segments
+        [[nodiscard]] std::size_t size() const {
+            return points.empty() ? 0 : points.size() - 1;
+        }
+
+        ///Calls visitor(segment) for each segment that intersects window
+        ///until the visitor returns false; returns false if stopped early
+        template<typename Visitor>
+        bool visit(const MBR<T> &window, Visitor &&visitor) const {
+            return index.visit(window, [&](const MBR<T> &, uint64_t id) {
+                auto &chain = chains[id];
+                //x keys increase along the chain once scaled by xdir
+                auto key = [&](std::size_t v) { return chain.xdir * static_cast<double>(points[v].x); };
+                auto lo = chain.xdir > 0 ? static_cast<double>(window.minx) : -static_cast<double>(window.maxx);
+                auto hi = chain.xdir > 0 ? static_cast<double>(window.maxx) : -static_cast<double>(window.minx);
+                //first segment whose far end reaches lo
+                auto seg = chain.first, end = chain.last;
+                auto count = end - seg;
+                while (count > 0) {
+                    auto half = count / 2;
+                    if (key(seg + half + 1) < lo) {
+                        seg += half + 1;
+                        count -= half + 1;
+                    }
+                    else {
+                        count = half;
+                    }
+                }
+                for (; seg < end && key(seg) <= hi; seg++) {
+                    if (window.intersects_segment(points[seg], points[seg + 1]) && !visitor(seg)) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+
+        ///Segments that intersect window, in polyline order
+        std::vector<std::size_t> search(const MBR<T> &window) const {
+            std::vector<std::size_t> segments;
+            visit(window, [&](std::size_t seg) {
+                segments.push_back(seg);
+                return true;
+            });
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+
+        ///Segments that intersect segment a b, in polyline order
+        std::vector<std::size_t> intersecting(const Pt<T> &a, const Pt<T> &b) const {
+            std::vector<std::size_t> segments;
+            visit(MBR<T>(a, b), [&](std::size_t seg) {
+                if (chains::segments_cross(a, b, points[seg], points[seg + 1])) {
+                    segments.push_back(seg);
+                }
+                return true;
+            });
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+    };
+}
+#endif //MBR_CHAINS_H
@@ -0,0 +1,246 @@
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#include "../mbr.h"
+#include "bounds.h"
+
+#ifndef MBR_CLIP_H
+#define MBR_CLIP_H
+namespace mbr {
+    namespace clip {
+        ///Vector of as many T as fit a register
+        template<typename T>
+        struct Lanes {
+            static constexpr std::size_t N = bounds::VECTOR_BYTES / sizeof(T);
+            typedef T Vec __attribute__((vector_size(bounds::VECTOR_BYTES)));
+        };
+
+        ///Tests, and when Clip is set clips, segments [begin, end) with
+        ///vectors of Lanes<T>::N segments and a scalar tail
+        template<bool Clip, typename T>
+        std::size_t run(const MBR<T> &box, const T *x0, const T *y0, const T *x1, const T *y1,
+                        std::size_t n, T *cx0, T *cy0, T *cx1, T *cy1, uint8_t *hits) {
+            using Vec = typename Lanes<T>::Vec;
+            constexpr auto N = Lanes<T>::N;
+            std::size_t count = 0;
+            std::size_t i = 0;
+            for (; i + N <= n; i += N) {
+                Vec ax{}, ay{}, bx{}, by{};
+                for (std::size_t j = 0; j < N; j++) {
+                    ax[j] = x0[i + j];
+                    ay[j] = y0[i + j];
+                    bx[j] = x1[i + j];
+                    by[j] = y1[i + j];
+                }
+                Vec dx = bx - ax, dy = by - ay;
+                Vec t0{}, t1 = t0 + 1;
+                slab<T>(ax, dx, box.minx, box.maxx, t0, t1);
+                slab<T>(ay, dy, box.miny, box.maxy, t0, t1);
+                auto hit = t0 <= t1;
+                if constexpr (Clip) {
+                    Vec one = Vec{} + 1;
+                    Vec px = ax + t0 * dx, py = ay + t0 * dy;
+                    Vec qx = t1 == one ? bx : ax + t1 * dx;
+                    Vec qy = t1 == one ? by : ay + t1 * dy;
+                    for (std::size_t j = 0; j < N; j++) {
+                        cx0[i + j] = px[j];
+                        cy0[i + j] = py[j];
+                        cx1[i + j] = qx[j];
+                        cy1[i + j] = qy[j];
+                    }
+                }
+                for (std::size_t j = 0; j < N; j++) {
+                    hits[i + j] = hit[j] != 0;
+                    count += hit[j] != 0;
+                }
+            }
+            for (; i < n; i++) {
+                T ax = x0[i], ay = y0[i], bx = x1[i], by = y1[i];
+                T dx = bx - ax, dy = by - ay;
+                T t0 = 0, t1 = 1;
+                slab<T>(ax, dx, box.minx, box.maxx, t0, t1);
+                slab<T>(ay, dy, box.miny, box.maxy, t0, t1);
+                if constexpr (Clip) {
+                    cx0[i] = ax + t0 * dx;
+                    cy0[i] = ay + t0 * dy;
+                    cx1[i] = t1 == 1 ? bx : ax + t1 * dx;
+                    cy1[i] = t1 == 1 ? by : ay + t1 * dy;
+                }
+                hits[i] = t0 <= t1;
+                count += t0 <= t1;
+            }
+            return count;
+        }
+    }
+
+    ///Exact test of n segments (x0, y0) - (x1, y1), stored as columns,
+    ///against box; sets hits[i] to 1 where segment i meets box and
+    ///returns the number of hits
+    template<typename T>
+    std::size_t segments_intersect(const MBR<T> &box, const T *x0, const T *y0, const T *x1, const T *y1,
+                                   std::size_t n, uint8_t *hits) {
+        static_assert(std::is_floating_point<T>::value, "batch clipping needs floating point coordinates");
+        T *none = nullptr;
+        return clip::run<false>(box, x0, y0, x1, y1, n, none, none, none, none, hits);
+    }
+
+    ///Clips n segments stored as columns against box into the c columns,
+    ///which may alias the inputs; clipped values are meaningful only
+    ///where hits[i] is 1. Returns the number of hits.
+    template<typename T>
+    std::size_t clip_segments(const MBR<T> &box, const T *x0, const T *y0, const T *x1, const T *y1,
+                              std::size_t n, T *cx0, T *cy0, T *cx1, T *cy1, uint8_t *hits) {
+        static_assert(std::is_floating_point<T>::value, "batch clipping needs floating point coordinates");
+        return clip::run<true>(box, x0, y0, x1, y1, n, cx0, cy0, cx1, cy1, hits);
+    }
+
+    ///Clips polylines and rings against a box into caller buffers. The
+    ///clipper keeps one scratch buffer, so a clipper and output buffers
+    ///reused across features make clipping allocation free once warm.
+    ///Features whose envelope is inside the box are copied and features
+    ///whose envelope misses the box are dropped without clipping.
+    template<typename T>
+    struct Clipper {
+        ///Clips ring pts[0, n) (Sutherland-Hodgman) into out, which is
+        ///cleared first; a closed ring gives a closed ring. Returns false
+        ///if nothing of the ring is inside the box.
+        bool ring(const MBR<T> &box, const Pt<T> *pts, std::size_t n, std::vector<Pt<T>> &out) {
+            out.clear();
+            if (n == 0) {
+                return false;
+            }
+            auto env = envelope(pts, n);
+            if (box.contains(env)) {
+                out.assign(pts, pts + n);
+                return true;
+            }
+            if (box.disjoint(env)) {
+                return false;
+            }
+            auto closed = n > 1 && same(pts[0], pts[n - 1]);
+            out.assign(pts, pts + n - closed);
+            edge(out, [&](const Pt<T> &p) { return p.x >= box.minx; }, [&](const Pt<T> &a, const Pt<T> &b) {
+                return at_x(a, b, box.minx);
+            });
+            edge(out, [&](const Pt<T> &p) { return p.x <= box.maxx; }, [&](const Pt<T> &a, const Pt<T> &b) {
+                return at_x(a, b, box.maxx);
+            });
+            edge(out, [&](const Pt<T> &p) { return p.y >= box.miny; }, [&](const Pt<T> &a, const Pt<T> &b) {
+                return at_y(a, b, box.miny);
+            });
+            edge(out, [&](const Pt<T> &p) { return p.y <= box.maxy; }, [&](const Pt<T> &a, const Pt<T> &b) {
+                return at_y(a, b, box.maxy);
+            });
+            if (out.empty()) {
+                return false;
+            }
+            if (closed) {
+                out.push_back(out.front());
+            }
+            return true;
+        }
+
+        bool ring(const MBR<T> &box, const std::vector<Pt<T>> &pts, std::vector<Pt<T>> &out) {
+            return ring(box, pts.data(), pts.size(), out);
+        }
+
+        ///Clips polyline pts[0, n) into the parts inside the box : part i
+        ///is out[offsets[i], offsets[i + 1]). Both buffers are cleared
+        ///first; returns the number of parts.
+        std::size_t polyline(const MBR<T> &box, const Pt<T> *pts, std::size_t n,
+                             std::vector<Pt<T>> &out, std::vector<std::size_t> &offsets) {
+            out.clear();
+            offsets.clear();
+            if (n == 0) {
+                return 0;
+            }
+            auto env = envelope(pts, n);
+            if (box.disjoint(env)) {
+                return 0;
+            }
+            offsets.push_back(0);
+            if (box.contains(env)) {
+                out.assign(pts, pts + n);
+                offsets.push_back(n);
+                return 1;
+            }
+            //inside is set while the previous segment ended in the box
+            bool inside = false;
+            for (std::size_t i = 0; i + 1 < n; i++) {
+                auto part = box.clip_segment(pts[i], pts[i + 1]);
+                if (!part) {
+                    inside = false;
+                    continue;
+                }
+                if (!inside || !same(part->first, pts[i])) {
+                    if (out.size() > offsets.back()) {
+                        offsets.push_back(out.size());
+                    }
+                    out.push_back(part->first);
+                }
+                out.push_back(part->second);
+                inside = same(part->second, pts[i + 1]);
+            }
+            if (out.size() > offsets.back()) {
+                offsets.push_back(out.size());
+            }
+            return offsets.size() - 1;
+        }
+
+        std::size_t polyline(const MBR<T> &box, const std::vector<Pt<T>> &pts,
+                             std::vector<Pt<T>> &out, std::vector<std::size_t> &offsets) {
+            return polyline(box, pts.data(), pts.size(), out, offsets);
+        }
+
+    private:
+        std::vector<Pt<T>> scratch;
+
+        static MBR<T> envelope(const Pt<T> *pts, std::size_t n) {
+            MBR<T> env(pts[0]);
+            for (std::size_t i = 1; i < n; i++) {
+                env.expand_to_include(pts[i].x, pts[i].y);
+            }
+            return env;
+        }
+
+        static bool same(const Pt<T> &a, const Pt<T> &b) {
+            return a.x == b.x && a.y == b.y;
+        }
+
+        static Pt<T> at_x(const Pt<T> &a, const Pt<T> &b, T x) {
+            auto t = (static_cast<double>(x) - a.x) / (static_cast<double>(b.x) - a.x);
+            return Pt<T>{x, static_cast<T>(a.y + t * (static_cast<double>(b.y) - a.y))};
+        }
+
+        static Pt<T> at_y(const Pt<T> &a, const Pt<T> &b, T y) {
+            auto t = (static_cast<double>(y) - a.y) / (static_cast<double>(b.y) - a.y);
+            return Pt<T>{static_cast<T>(a.x + t * (static_cast<double>(b.x) - a.x)), y};
+        }
+
+        ///Keeps the part of ring pts on the inner side of one box edge
+        template<typename Inside, typename Cross>
+        void edge(std::vector<Pt<T>> &pts, Inside &&inside, Cross &&cross) {
+            if (pts.empty()) {
+                return;
+            }
+            scratch.clear();
+            auto prev = pts.back();
+            auto prev_in = inside(prev);
+            for (auto &cur : pts) {
+                auto cur_in = inside(cur);
+                if (cur_in != prev_in) {
+                    scratch.push_back(cross(prev, cur));
+                }
+                if (cur_in) {
+                    scratch.push_back(cur);
+                }
+                prev = cur;
+                prev_in = cur_in;
+            }
+            pts.swap(scratch);
+        }
+    };
+}
+#endif //MBR_CLIP_H
@@ -0,0 +1,170 @@
+#include <cmath>
+#include <queue>
+#include <vector>
+#include <iterator>
+#include <memory_resource>
+
+#include "index.h"
+
+#ifndef MBR_CURSOR_H
+#define MBR_CURSOR_H
+namespace mbr {
+    ///Input iterator pulling values from a cursor with bool next(Value&)
+    template<typename Cursor, typename Value>
+    struct CursorIterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value *;
+        using reference = const Value &;
+
+        Cursor *cursor = nullptr;
+        Value value{};
+
+        reference operator*() const { return value; }
+
+        pointer operator->() const { return &value; }
+
+        CursorIterator &operator++() {
+            if (!cursor->next(value)) {
+                cursor = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator==(const CursorIterator &other) const { return cursor == other.cursor; }
+
+        bool operator!=(const CursorIterator &other) const { return cursor != other.cursor; }
+    };
+
+    ///Lazy window query : traversal is suspended between hits, so
+    ///callers can stop at any point without buffering results
+    template<typename T>
+    struct SearchCursor {
+        using iterator = CursorIterator<SearchCursor, uint64_t>;
+
+        SearchCursor(const IndexView<T> &index, const MBR<T> &query,
+                     std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                index(index), query(query), stack(resource) {
+            if (!index.empty()) {
+                node = pos = index.num_nodes - 1;
+                end_pos = index.num_nodes;
+            }
+        }
+
+        ///Pulls the id of the next item that intersects query
+        bool next(uint64_t &id) {
+            while (true) {
+                while (pos < end_pos) {
+                    auto p = pos++;
+                    if (!query.intersects(index.boxes[p])) {
+                        continue;
+                    }
+                    if (node < index.num_items) {
+                        id = index.indices[p];
+                        return true;
+                    }
+                    stack.push_back(index.indices[p]);
+                }
+                if (stack.empty()) {
+                    return false;
+                }
+                node = pos = stack.back();
+                stack.pop_back();
+                end_pos = std::min(node + index.node_size, index.level_end(node));
+            }
+        }
+
+        iterator begin() { return ++iterator{this}; }
+
+        iterator end() { return iterator{}; }
+
+    private:
+        IndexView<T> index;
+        MBR<T> query;
+        uint64_t node = 0;
+        uint64_t pos = 0;
+        uint64_t end_pos = 0;
+        std::pmr::vector<uint64_t> stack;
+    };
+
+    ///Item yielded by a nearest neighbour cursor
+    struct NearestItem {
+        uint64_t id;
+        double distance;
+    };
+
+    ///Incremental nearest neighbour query : yields items by increasing
+    ///box distance for as long as the caller keeps pulling, so k does
+    ///not have to be known in advance
+    template<typename T>
+    struct NearestCursor {
+        using iterator = CursorIterator<NearestCursor, NearestItem>;
+
+        NearestCursor(const IndexView<T> &index, const MBR<T> &query,
+                      double max_distance = std::numeric_limits<double>::infinity(),
+                      std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                index(index), query(query), max_dist(max_distance * max_distance),
+                queue(std::greater<Neighbor>{}, std::pmr::vector<Neighbor>(resource)) {
+            if (!index.empty()) {
+                queue.push({0.0, index.num_nodes - 1, false});
+            }
+        }
+
+        ///Pulls the next nearest item
+        bool next(NearestItem &item) {
+            while (!queue.empty()) {
+                auto top = queue.top();
+                queue.pop();
+                if (top.leaf) {
+                    item = {top.id, std::sqrt(top.dist)};
+                    return true;
+                }
+                auto node = top.id;
+                auto end = std::min(node + index.node_size, index.level_end(node));
+                for (auto pos = node; pos < end; pos++) {
+                    auto dist = query.distance_square(index.boxes[pos]);
+                    if (dist <= max_dist) {
+                        queue.push({dist, index.indices[pos], node < index.num_items});
+                    }
+                }
+            }
+            return false;
+        }
+
+        iterator begin() { return ++iterator{this}; }
+
+        iterator end() { return iterator{}; }
+
+    private:
+        IndexView<T> index;
+        MBR<T> query;
+        double max_dist;
+        std::priority_queue<Neighbor, std::pmr::vector<Neighbor>, std::greater<Neighbor>> queue;
+    };
+
+    ///Lazy window query over index
+    template<typename T>
+    SearchCursor<T> lazy_search(const IndexView<T> &index, const MBR<T> &query) {
+        return SearchCursor<T>(index, query);
+    }
+
+    template<typename T>
+    SearchCursor<T> lazy_search(const Index<T> &index, const MBR<T> &query) {
+        return SearchCursor<T>(index.view(), query);
+    }
+
+    ///Lazy nearest neighbours of query over index
+    template<typename T>
+    NearestCursor<T> lazy_nearest(const IndexView<T> &index, const MBR<T> &query,
+                                  double max_distance = std::numeric_limits<double>::infinity()) {
+        return NearestCursor<T>(index, query, max_distance);
+    }
+
+    template<typename T>
+    NearestCursor<T> lazy_nearest(const Index<T> &index, const MBR<T> &query,
+                                  double max_distance = std::numeric_limits<double>::infinity()) {
+        return NearestCursor<T>(index.view(), query, max_distance);
+    }
+}
+#endif //MBR_CURSOR_H
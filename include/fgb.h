@@ -0,0 +1,255 @@
+#include <deque>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "index.h"
+
+#ifndef MBR_FGB_H
+#define MBR_FGB_H
+namespace mbr {
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+                  "FlatGeobuf index nodes are read and written as little endian");
+
+    namespace fgb {
+        ///Node of a FlatGeobuf packed Hilbert R-tree, 40 bytes on disk.
+        ///offset is the feature byte offset for leaves and the node
+        ///position of the first child otherwise.
+        struct NodeItem {
+            double minx;
+            double miny;
+            double maxx;
+            double maxy;
+            uint64_t offset;
+        };
+        static_assert(sizeof(NodeItem) == 40);
+
+        ///Rejects node sizes that cannot form a tree, e.g. from a corrupt header
+        inline void check_node_size(uint64_t node_size) {
+            if (node_size < 2) {
+                throw std::invalid_argument("FlatGeobuf index node size must be at least 2, got " +
+                                            std::to_string(node_size));
+            }
+        }
+
+        ///[start, end) node positions of each level, leaves first;
+        ///levels are stored root first so leaves are at the end
+        inline std::vector<std::pair<uint64_t, uint64_t>> level_bounds(uint64_t num_items, uint64_t node_size) {
+            check_node_size(node_size);
+            std::vector<uint64_t> counts{num_items};
+            auto n = num_items;
+            auto num_nodes = n;
+            do {
+                n = (n + node_size - 1) / node_size;
+                num_nodes += n;
+                counts.push_back(n);
+            } while (n != 1);
+            std::vector<std::pair<uint64_t, uint64_t>> bounds;
+            for (auto count : counts) {
+                bounds.emplace_back(num_nodes - count, num_nodes);
+                num_nodes -= count;
+            }
+            return bounds;
+        }
+
+        inline uint64_t index_size(uint64_t num_items, uint64_t node_size) {
+            if (num_items == 0) {
+                return 0;
+            }
+            return level_bounds(num_items, node_size).front().second * sizeof(NodeItem);
+        }
+
+        inline bool intersects(const NodeItem &n, const MBR<double> &q) {
+            return !(n.minx > q.maxx || n.maxx < q.minx || n.miny > q.maxy || n.maxy < q.miny);
+        }
+    }
+
+    ///Leaf hit of a FlatGeobuf index search
+    struct FgbItem {
+        ///Feature offset stored in the leaf
+        uint64_t offset;
+        ///Position of the leaf in Hilbert order
+        uint64_t index;
+    };
+
+    ///Builds the FlatGeobuf packed Hilbert R-tree index section for boxes.
+    ///Leaves hold offsets[i], or i when offsets is nullptr, and are sorted
+    ///by descending Hilbert value of their center as FlatGeobuf does.
+    ///Throws std::invalid_argument if node_size is below 2.
+    template<typename T>
+    std::vector<uint8_t> fgb_index(const MBR<T> *boxes, std::size_t n,
+                                   const uint64_t *offsets = nullptr, uint16_t node_size = 16) {
+        fgb::check_node_size(node_size);
+        std::vector<uint8_t> out;
+        if (n == 0) {
+            return out;
+        }
+        auto bounds = fgb::level_bounds(n, node_size);
+        auto num_nodes = bounds.front().second;
+        std::vector<fgb::NodeItem> nodes(num_nodes);
+
+        auto extent = boxes[0];
+        for (std::size_t i = 1; i < n; i++) {
+            extent.expand_to_include(boxes[i]);
+        }
+        std::vector<std::pair<uint32_t, uint64_t>> order(n);
+        for (std::size_t i = 0; i < n; i++) {
+            order[i] = {hilbert(boxes[i], extent), i};
+        }
+        std::stable_sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+            return a.first > b.first;
+        });
+
+        auto leaf = bounds.front().first;
+        for (std::size_t i = 0; i < n; i++) {
+            auto &b = boxes[order[i].second];
+            nodes[leaf + i] = fgb::NodeItem{
+                    static_cast<double>(b.minx), static_cast<double>(b.miny),
+                    static_cast<double>(b.maxx), static_cast<double>(b.maxy),
+                    offsets ? offsets[order[i].second] : order[i].second,
+            };
+        }
+        for (std::size_t lvl = 0; lvl + 1 < bounds.size(); lvl++) {
+            auto pos = bounds[lvl].first;
+            auto end = bounds[lvl].second;
+            auto out_pos = bounds[lvl + 1].first;
+            while (pos < end) {
+                auto node = fgb::NodeItem{nodes[pos].minx, nodes[pos].miny,
+                                          nodes[pos].maxx, nodes[pos].maxy, pos};
+                pos++;
+                for (uint64_t j = 1; j < node_size && pos < end; j++, pos++) {
+                    node.minx = std::min(node.minx, nodes[pos].minx);
+                    node.miny = std::min(node.miny, nodes[pos].miny);
+                    node.maxx = std::max(node.maxx, nodes[pos].maxx);
+                    node.maxy = std::max(node.maxy, nodes[pos].maxy);
+                }
+                nodes[out_pos++] = node;
+            }
+        }
+        out.resize(num_nodes * sizeof(fgb::NodeItem));
+        std::memcpy(out.data(), nodes.data(), out.size());
+        return out;
+    }
+
+    ///Writes the FlatGeobuf index section for boxes to a local file
+    template<typename T>
+    void write_fgb_index(const std::string &path, const MBR<T> *boxes, std::size_t n,
+                         const uint64_t *offsets = nullptr, uint16_t node_size = 16) {
+        auto bytes = fgb_index(boxes, n, offsets, node_size);
+        auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        std::size_t done = 0;
+        while (done < bytes.size()) {
+            auto w = ::write(fd, bytes.data() + done, bytes.size() - done);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w < 0) {
+                auto err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "write " + path);
+            }
+            done += static_cast<std::size_t>(w);
+        }
+        close(fd);
+    }
+
+    ///Queries a FlatGeobuf packed R-tree in a file by reading only the
+    ///nodes a search visits. index_offset is where the index section
+    ///starts, 0 for a standalone index or past the header of an .fgb file.
+    ///Throws std::invalid_argument if node_size is below 2.
+    struct FgbIndexReader {
+        FgbIndexReader(const std::string &path, uint64_t num_items,
+                       uint16_t node_size = 16, uint64_t index_offset = 0) :
+                num_items(num_items), node_size(node_size), index_offset(index_offset) {
+            fgb::check_node_size(node_size);
+            if (num_items > 0) {
+                bounds = fgb::level_bounds(num_items, node_size);
+            }
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path);
+            }
+        }
+
+        FgbIndexReader(const FgbIndexReader &) = delete;
+
+        FgbIndexReader &operator=(const FgbIndexReader &) = delete;
+
+        ~FgbIndexReader() {
+            close(fd);
+        }
+
+        uint64_t num_items;
+        uint64_t node_size;
+        uint64_t index_offset;
+        ///Bytes of index read so far
+        mutable uint64_t bytes_read = 0;
+
+        ///Leaves whose box intersects query, each level read in node ranges.
+        ///Throws std::runtime_error if a child offset falls outside the level below.
+        std::vector<FgbItem> search(const MBR<double> &query) const {
+            std::vector<FgbItem> results;
+            if (num_items == 0) {
+                return results;
+            }
+            auto leaf_start = bounds.front().first;
+            std::vector<fgb::NodeItem> nodes(node_size);
+            std::deque<std::pair<uint64_t, std::size_t>> queue{{0, bounds.size() - 1}};
+            while (!queue.empty()) {
+                auto [node, level] = queue.front();
+                queue.pop_front();
+                if (node < bounds[level].first || node >= bounds[level].second) {
+                    throw std::runtime_error("corrupt FlatGeobuf index: child node " + std::to_string(node) +
+                                             " outside level " + std::to_string(level));
+                }
+                auto end = std::min(node + node_size, bounds[level].second);
+                read(node, end - node, nodes.data());
+                for (auto pos = node; pos < end; pos++) {
+                    auto &item = nodes[pos - node];
+                    if (!fgb::intersects(item, query)) {
+                        continue;
+                    }
+                    if (node >= leaf_start) {
+                        results.push_back({item.offset, pos - leaf_start});
+                    }
+                    else {
+                        queue.emplace_back(item.offset, level - 1);
+                    }
+                }
+            }
+            return results;
+        }
+
+    private:
+        int fd = -1;
+        std::vector<std::pair<uint64_t, uint64_t>> bounds;
+
+        void read(uint64_t node, uint64_t count, fgb::NodeItem *out) const {
+            auto size = count * sizeof(fgb::NodeItem);
+            auto offset = index_offset + node * sizeof(fgb::NodeItem);
+            auto dst = reinterpret_cast<char *>(out);
+            std::size_t done = 0;
+            while (done < size) {
+                auto r = pread(fd, dst + done, size - done, static_cast<off_t>(offset + done));
+                if (r < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (r <= 0) {
+                    throw std::system_error(r < 0 ? errno : EIO, std::generic_category(), "pread");
+                }
+                done += static_cast<std::size_t>(r);
+            }
+            bytes_read += size;
+        }
+    };
+}
+#endif //MBR_FGB_H
@@ -0,0 +1,433 @@
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <iterator>
+#include <memory_resource>
+#include <algorithm>
+
+#include "../mbr.h"
+
+#ifndef MBR_INDEX_H
+#define MBR_INDEX_H
+namespace mbr {
+    ///Hilbert curve distance of x, y in a 2^16 x 2^16 grid
+    [[using gnu : const, always_inline, hot]]
+    constexpr uint32_t hilbert(uint32_t x, uint32_t y) {
+        uint32_t a = x ^ y;
+        uint32_t b = 0xFFFF ^ a;
+        uint32_t c = 0xFFFF ^ (x | y);
+        uint32_t d = x & (y ^ 0xFFFF);
+
+        uint32_t A = a | (b >> 1);
+        uint32_t B = (a >> 1) ^ a;
+        uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A, b = B, c = C, d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A, b = B, c = C, d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A, b = B, c = C, d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        uint32_t i0 = x ^ y;
+        uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+    ///Hilbert value of the center of box scaled over extent; centers
+    ///outside extent, or NaN, are clamped onto its edges
+    template<typename T>
+    constexpr uint32_t hilbert(const MBR<T> &box, const MBR<T> &extent) {
+        constexpr double n = 0xFFFF;
+        auto clamp = [](double v) { return v > n ? n : v > 0 ? v : 0.0; };
+        auto c = box.center();
+        auto w = static_cast<double>(extent.width());
+        auto h = static_cast<double>(extent.height());
+        auto hx = w > 0 ? n * (static_cast<double>(c.x - extent.minx) / w) : 0.0;
+        auto hy = h > 0 ? n * (static_cast<double>(c.y - extent.miny) / h) : 0.0;
+        return hilbert(static_cast<uint32_t>(clamp(hx)), static_cast<uint32_t>(clamp(hy)));
+    }
+
+    ///Queue entry of a nearest neighbour search, a leaf item or a node
+    struct Neighbor {
+        double dist;
+        uint64_t id;
+        bool leaf;
+
+        bool operator>(const Neighbor &other) const {
+            return dist > other.dist || (dist == other.dist && !leaf && other.leaf);
+        }
+    };
+
+    ///Per thread scratch space reused across queries, so the hot query
+    ///paths grow it once instead of allocating on every call
+    struct QueryScratch {
+        std::vector<Neighbor> heap;
+        ///Heap of raycast, borrowed for the length of a cast
+        std::vector<Neighbor> rays;
+
+        static QueryScratch &local() {
+            thread_local QueryScratch scratch;
+            return scratch;
+        }
+    };
+
+    ///Layout shared by the packed trees (Index, SpaceTimeIndex,
+    ///MovingIndex) : nodes stored level by level, leaves first and the
+    ///root last, each node holding up to node_size consecutive children.
+    namespace packed {
+        ///Appends the end position of each level, leaves first, for
+        ///num_items leaves; the last entry is the number of nodes
+        template<typename Bounds>
+        void level_bounds(uint64_t num_items, uint64_t node_size, Bounds &out) {
+            auto count = num_items;
+            auto num_nodes = count;
+            out.push_back(num_nodes);
+            do {
+                count = (count + node_size - 1) / node_size;
+                num_nodes += count;
+                out.push_back(num_nodes);
+            } while (count != 1);
+        }
+
+        ///Leaf order that sorts keys ascending
+        template<typename Key>
+        std::vector<uint64_t> order(const std::vector<Key> &keys) {
+            std::vector<uint64_t> out(keys.size());
+            std::iota(out.begin(), out.end(), 0);
+            std::sort(out.begin(), out.end(), [&](uint64_t a, uint64_t b) {
+                return keys[a] < keys[b];
+            });
+            return out;
+        }
+
+        ///Fills the levels above the leaves : a node is fit(first, end)
+        ///over its children [first, end), and its index is first
+        template<typename Node, typename Fit>
+        void build(Node *nodes, uint64_t *indices, const uint64_t *level_bounds, uint64_t num_levels,
+                   uint64_t node_size, Fit &&fit) {
+            uint64_t pos = 0;
+            for (std::size_t lvl = 0; lvl + 1 < num_levels; lvl++) {
+                auto end = level_bounds[lvl];
+                for (auto out = end; pos < end; out++) {
+                    auto last = std::min(pos + node_size, end);
+                    nodes[out] = fit(pos, last);
+                    indices[out] = pos;
+                    pos = last;
+                }
+            }
+        }
+
+        ///Fills the levels above the leaves with nodes that bound their
+        ///children through Node::expand_to_include
+        template<typename Node>
+        void build(Node *nodes, uint64_t *indices, const uint64_t *level_bounds, uint64_t num_levels,
+                   uint64_t node_size) {
+            build(nodes, indices, level_bounds, num_levels, node_size, [&](uint64_t first, uint64_t end) {
+                auto node = nodes[first];
+                for (auto pos = first + 1; pos < end; pos++) {
+                    node.expand_to_include(nodes[pos]);
+                }
+                return node;
+            });
+        }
+
+        ///Read-only packed tree of any node type
+        template<typename Node>
+        struct Tree {
+            const Node *nodes;
+            const uint64_t *indices;
+            const uint64_t *level_bounds;
+            uint64_t num_items;
+            uint64_t num_levels;
+            uint64_t node_size;
+
+            ///End position of the level that contains node
+            [[nodiscard]] uint64_t level_end(uint64_t node) const {
+                return *std::upper_bound(level_bounds, level_bounds + num_levels, node);
+            }
+
+            ///Depth first from the root, opening the nodes for which
+            ///overlaps(node) holds and calling visitor(node, id) for each
+            ///leaf that passes, until the visitor returns false; returns
+            ///false if stopped early. Does not allocate unless
+            ///node_size * num_levels > 256.
+            template<typename Overlaps, typename Visitor>
+            bool visit(Overlaps &&overlaps, Visitor &&visitor) const {
+                if (num_items == 0) {
+                    return true;
+                }
+                uint64_t inline_stack[256];
+                std::vector<uint64_t> heap_stack;
+                auto stack = inline_stack;
+                if (node_size * num_levels > std::size(inline_stack)) {
+                    heap_stack.resize(node_size * num_levels);
+                    stack = heap_stack.data();
+                }
+                std::size_t top = 0;
+                uint64_t node = level_bounds[num_levels - 1] - 1;
+                while (true) {
+                    auto end = std::min(node + node_size, level_end(node));
+                    for (auto pos = node; pos < end; pos++) {
+                        if (!overlaps(nodes[pos])) {
+                            continue;
+                        }
+                        if (node >= num_items) {
+                            stack[top++] = indices[pos];
+                        }
+                        else if (!visitor(nodes[pos], indices[pos])) {
+                            return false;
+                        }
+                    }
+                    if (top == 0) {
+                        return true;
+                    }
+                    node = stack[--top];
+                }
+            }
+        };
+    }
+
+    ///Read-only view over the flat arrays of a packed index.
+    ///Nodes are stored level by level, leaves first and the root last;
+    ///indices holds the item id of a leaf or the position of the
+    ///first child of an internal node.
+    template<typename T>
+    struct IndexView {
+        const MBR<T> *boxes = nullptr;
+        const uint64_t *indices = nullptr;
+        const uint64_t *level_bounds = nullptr;
+        uint64_t num_items = 0;
+        uint64_t num_nodes = 0;
+        uint64_t num_levels = 0;
+        uint64_t node_size = 16;
+
+        [[nodiscard]] bool empty() const { return num_items == 0; }
+
+        [[nodiscard]] uint64_t size() const { return num_items; }
+
+        ///Bounds of all items in the index
+        [[nodiscard]] MBR<T> bounds() const {
+            return empty() ? MBR<T>{} : boxes[num_nodes - 1];
+        }
+
+        ///End position of the level that contains node
+        [[nodiscard]] uint64_t level_end(uint64_t node) const {
+            return tree().level_end(node);
+        }
+
+        [[nodiscard]] packed::Tree<MBR<T>> tree() const {
+            return {boxes, indices, level_bounds, num_items, num_levels, node_size};
+        }
+
+        ///Ids of items whose box intersects query
+        std::vector<uint64_t> search(const MBR<T> &query) const {
+            std::vector<uint64_t> results;
+            search(query, results);
+            return results;
+        }
+
+        ///Appends ids of items whose box intersects query to results
+        void search(const MBR<T> &query, std::vector<uint64_t> &results) const {
+            visit(query, [&](const MBR<T> &, uint64_t id) {
+                results.push_back(id);
+                return true;
+            });
+        }
+
+        ///Calls visitor(box, id) for each item whose box intersects query
+        ///until the visitor returns false; returns false if stopped early.
+        ///Traversal does not allocate unless node_size * num_levels > 256.
+        template<typename Visitor>
+        bool visit(const MBR<T> &query, Visitor &&visitor) const {
+            return tree().visit([&](const MBR<T> &box) { return query.intersects(box); },
+                                std::forward<Visitor>(visitor));
+        }
+
+        ///Checks if any item intersects query
+        [[nodiscard]] bool any(const MBR<T> &query) const {
+            return !visit(query, [](const MBR<T> &, uint64_t) { return false; });
+        }
+
+        ///Number of items that intersect query
+        [[nodiscard]] std::size_t count(const MBR<T> &query) const {
+            std::size_t n = 0;
+            visit(query, [&](const MBR<T> &, uint64_t) {
+                n++;
+                return true;
+            });
+            return n;
+        }
+
+        ///Id of the first item found that intersects query
+        [[nodiscard]] std::optional<uint64_t> first(const MBR<T> &query) const {
+            std::optional<uint64_t> hit;
+            visit(query, [&](const MBR<T> &, uint64_t id) {
+                hit = id;
+                return false;
+            });
+            return hit;
+        }
+
+        ///Ids of the k items nearest to query by box distance, nearest first
+        std::vector<uint64_t> knn(const MBR<T> &query, std::size_t k,
+                                  double max_distance = std::numeric_limits<double>::infinity()) const {
+            std::vector<uint64_t> results;
+            knn(query, k, results, max_distance);
+            return results;
+        }
+
+        ///Appends ids of the k items nearest to query to results
+        void knn(const MBR<T> &query, std::size_t k, std::vector<uint64_t> &results,
+                 double max_distance = std::numeric_limits<double>::infinity()) const {
+            if (empty() || k == 0) {
+                return;
+            }
+            auto max_dist = max_distance * max_distance;
+            auto &heap = QueryScratch::local().heap;
+            heap.clear();
+            auto push = [&](const Neighbor &n) {
+                heap.push_back(n);
+                std::push_heap(heap.begin(), heap.end(), std::greater<Neighbor>{});
+            };
+            auto pop = [&] {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<Neighbor>{});
+                heap.pop_back();
+            };
+            std::size_t found = 0;
+            uint64_t node = num_nodes - 1;
+            while (true) {
+                auto end = std::min(node + node_size, level_end(node));
+                for (auto pos = node; pos < end; pos++) {
+                    auto dist = query.distance_square(boxes[pos]);
+                    if (dist <= max_dist) {
+                        push({dist, indices[pos], node < num_items});
+                    }
+                }
+                while (!heap.empty() && heap.front().leaf) {
+                    results.push_back(heap.front().id);
+                    pop();
+                    if (++found == k) {
+                        return;
+                    }
+                }
+                if (heap.empty()) {
+                    return;
+                }
+                node = heap.front().id;
+                pop();
+            }
+        }
+    };
+
+    ///Static packed Hilbert R-tree, bulk loaded from a list of boxes.
+    ///Item ids are positions in the input list. Node arrays come from
+    ///resource, e.g. an arena or pool memory resource.
+    template<typename T>
+    struct Index {
+        uint64_t num_items = 0;
+        uint64_t node_size = 16;
+        std::pmr::vector<MBR<T>> boxes;
+        std::pmr::vector<uint64_t> indices;
+        std::pmr::vector<uint64_t> level_bounds;
+
+        Index() = default;
+
+        explicit Index(const std::vector<MBR<T>> &items, uint64_t node_size = 16,
+                       std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                Index(items.data(), items.size(), node_size, resource) {}
+
+        Index(const MBR<T> *items, std::size_t n, uint64_t node_size = 16,
+              std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                num_items(n), node_size(std::max<uint64_t>(node_size, 2)),
+                boxes(resource), indices(resource), level_bounds(resource) {
+            if (n == 0) {
+                return;
+            }
+            packed::level_bounds(num_items, this->node_size, level_bounds);
+
+            auto extent = items[0];
+            for (std::size_t i = 1; i < n; i++) {
+                extent.expand_to_include(items[i]);
+            }
+
+            std::vector<uint32_t> hvals(n);
+            for (std::size_t i = 0; i < n; i++) {
+                hvals[i] = hilbert(items[i], extent);
+            }
+            auto order = packed::order(hvals);
+
+            boxes.resize(level_bounds.back());
+            indices.resize(level_bounds.back());
+            for (std::size_t i = 0; i < n; i++) {
+                boxes[i] = items[order[i]];
+                indices[i] = order[i];
+            }
+            packed::build(boxes.data(), indices.data(), level_bounds.data(), level_bounds.size(), this->node_size);
+        }
+
+        [[nodiscard]] IndexView<T> view() const {
+            return IndexView<T>{
+                    boxes.data(), indices.data(), level_bounds.data(),
+                    num_items, boxes.size(), level_bounds.size(), node_size,
+            };
+        }
+
+        [[nodiscard]] bool empty() const { return num_items == 0; }
+
+        [[nodiscard]] uint64_t size() const { return num_items; }
+
+        [[nodiscard]] MBR<T> bounds() const { return view().bounds(); }
+
+        ///Ids of items whose box intersects query
+        std::vector<uint64_t> search(const MBR<T> &query) const {
+            return view().search(query);
+        }
+
+        ///Calls visitor(box, id) for each item whose box intersects query
+        ///until the visitor returns false; returns false if stopped early
+        template<typename Visitor>
+        bool visit(const MBR<T> &query, Visitor &&visitor) const {
+            return view().visit(query, std::forward<Visitor>(visitor));
+        }
+
+        [[nodiscard]] bool any(const MBR<T> &query) const { return view().any(query); }
+
+        [[nodiscard]] std::size_t count(const MBR<T> &query) const { return view().count(query); }
+
+        [[nodiscard]] std::optional<uint64_t> first(const MBR<T> &query) const { return view().first(query); }
+
+        ///Ids of the k items nearest to query by box distance, nearest first
+        std::vector<uint64_t> knn(const MBR<T> &query, std::size_t k,
+                                  double max_distance = std::numeric_limits<double>::infinity()) const {
+            return view().knn(query, k, max_distance);
+        }
+    };
+}
+#endif //MBR_INDEX_H
@@ -0,0 +1,62 @@
+#include <string>
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MBR_MMAP_H
+#define MBR_MMAP_H
+namespace mbr {
+    ///Read-only memory mapping of a whole file
+    struct MappedFile {
+        explicit MappedFile(const std::string &path, int advice = MADV_SEQUENTIAL) {
+            auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path);
+            }
+            struct stat st{};
+            if (fstat(fd, &st) != 0) {
+                auto err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "fstat " + path);
+            }
+            len = static_cast<std::size_t>(st.st_size);
+            if (len > 0) {
+                auto ptr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr == MAP_FAILED) {
+                    auto err = errno;
+                    close(fd);
+                    throw std::system_error(err, std::generic_category(), "mmap " + path);
+                }
+                madvise(ptr, len, advice);
+                bytes = static_cast<const char *>(ptr);
+            }
+            close(fd);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile() {
+            if (bytes) {
+                munmap(const_cast<char *>(bytes), len);
+            }
+        }
+
+        [[nodiscard]] const char *data() const { return bytes; }
+
+        [[nodiscard]] std::size_t size() const { return len; }
+
+        [[nodiscard]] const char *begin() const { return bytes; }
+
+        [[nodiscard]] const char *end() const { return bytes + len; }
+
+    private:
+        const char *bytes = nullptr;
+        std::size_t len = 0;
+    };
+}
+#endif //MBR_MMAP_H
@@ -0,0 +1,209 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "index.h"
+
+#ifndef MBR_MOVING_H
+#define MBR_MOVING_H
+namespace mbr {
+    ///Box of a moving object : box at reference time plus velocity bounds,
+    ///velocity.minx being the velocity of the min x edge and so on. Edges
+    ///move linearly, so the box only changes when the object leaves them.
+    template<typename T>
+    struct MovingBox {
+        MBR<T> box;
+        MBR<T> velocity;
+        double time = 0;
+
+        ///Box at time t
+        [[nodiscard]] constexpr MBR<T> at(double t) const {
+            auto dt = t - time;
+            auto c = velocity.center();
+            return box.translate(static_cast<T>(c.x * dt), static_cast<T>(c.y * dt))
+                    .expand_by_delta(static_cast<T>(velocity.width() / 2 * dt),
+                                     static_cast<T>(velocity.height() / 2 * dt));
+        }
+
+        ///Same motion expressed from reference time t
+        [[nodiscard]] constexpr MovingBox rebase(double t) const {
+            return MovingBox{edges(t), velocity, t};
+        }
+
+        ///Edges extrapolated to time t, not reordered
+        [[nodiscard]] constexpr MBR<T> edges(double t) const {
+            auto dt = t - time;
+            return MBR<T>{static_cast<T>(box.minx + velocity.minx * dt),
+                          static_cast<T>(box.miny + velocity.miny * dt),
+                          static_cast<T>(box.maxx + velocity.maxx * dt),
+                          static_cast<T>(box.maxy + velocity.maxy * dt), true};
+        }
+
+        ///Checks if the box intersects window at some time in [t1, t2]
+        [[nodiscard]] constexpr bool intersects(const MBR<T> &window, double t1, double t2) const {
+            auto lo = t1 - time, hi = t2 - time;
+            //each edge against the window bounds the time range to a half line
+            auto clip = [&](double p, double v, double q) {
+                //p + v * dt <= q
+                if (v == 0) {
+                    if (p > q) {
+                        hi = lo - 1;
+                    }
+                }
+                else if (v > 0) {
+                    hi = std::min(hi, (q - p) / v);
+                }
+                else {
+                    lo = std::max(lo, (q - p) / v);
+                }
+            };
+            clip(box.minx, velocity.minx, window.maxx);
+            clip(box.miny, velocity.miny, window.maxy);
+            clip(-box.maxx, -velocity.maxx, -window.minx);
+            clip(-box.maxy, -velocity.maxy, -window.miny);
+            return lo <= hi;
+        }
+
+        ///Expand to bound other from time on
+        constexpr MovingBox &expand_to_include(const MovingBox &other) {
+            auto e = other.edges(time);
+            box = MBR<T>{std::min(box.minx, e.minx), std::min(box.miny, e.miny),
+                         std::max(box.maxx, e.maxx), std::max(box.maxy, e.maxy), true};
+            velocity.expand_to_include(other.velocity);
+            return *this;
+        }
+    };
+
+    ///Packed R-tree over moving boxes in the style of a TPR-tree : each
+    ///node bounds its children from the index reference time on, with
+    ///edges that move at the extreme child velocities, so queries about
+    ///the future need no update as objects move. An object is updated
+    ///only when its motion changes, by refitting the nodes above its leaf.
+    ///Queries cover times from the reference time on. Item ids are
+    ///positions in the input list.
+    template<typename T>
+    struct MovingIndex {
+        uint64_t num_items = 0;
+        uint64_t node_size = 16;
+        double time = 0;
+        std::vector<MovingBox<T>> nodes;
+        std::vector<uint64_t> indices;
+        std::vector<uint64_t> level_bounds;
+
+        MovingIndex() = default;
+
+        explicit MovingIndex(const std::vector<MovingBox<T>> &items, uint64_t node_size = 16) :
+                MovingIndex(items.data(), items.size(), node_size) {}
+
+        ///Reference time is the earliest item time
+        MovingIndex(const MovingBox<T> *items, std::size_t n, uint64_t node_size = 16) :
+                MovingIndex(items, n, earliest(items, n), node_size) {}
+
+        MovingIndex(const MovingBox<T> *items, std::size_t n, double time, uint64_t node_size) :
+                num_items(n), node_size(std::max<uint64_t>(node_size, 2)), time(time) {
+            if (n == 0) {
+                return;
+            }
+            packed::level_bounds(num_items, this->node_size, level_bounds);
+
+            std::vector<MBR<T>> now(n);
+            for (std::size_t i = 0; i < n; i++) {
+                now[i] = items[i].at(time);
+            }
+            auto extent = now[0];
+            for (std::size_t i = 1; i < n; i++) {
+                extent.expand_to_include(now[i]);
+            }
+            std::vector<uint32_t> hvals(n);
+            for (std::size_t i = 0; i < n; i++) {
+                hvals[i] = hilbert(now[i], extent);
+            }
+            auto order = packed::order(hvals);
+
+            nodes.resize(level_bounds.back());
+            indices.resize(level_bounds.back());
+            leaves.resize(n);
+            for (std::size_t i = 0; i < n; i++) {
+                nodes[i] = items[order[i]];
+                indices[i] = order[i];
+                leaves[order[i]] = i;
+            }
+            packed::build(nodes.data(), indices.data(), level_bounds.data(), level_bounds.size(), this->node_size,
+                          [&](uint64_t first, uint64_t end) { return fit(first, end); });
+        }
+
+        [[nodiscard]] bool empty() const { return num_items == 0; }
+
+        [[nodiscard]] uint64_t size() const { return num_items; }
+
+        ///Current motion of item id
+        [[nodiscard]] const MovingBox<T> &item(uint64_t id) const {
+            return nodes[leaves[id]];
+        }
+
+        ///Replaces the motion of item id and refits the nodes above it
+        void update(uint64_t id, const MovingBox<T> &box) {
+            auto pos = leaves[id];
+            nodes[pos] = box;
+            for (std::size_t lvl = 0; lvl + 1 < level_bounds.size(); lvl++) {
+                auto start = lvl == 0 ? 0 : level_bounds[lvl - 1];
+                auto parent = level_bounds[lvl] + (pos - start) / node_size;
+                nodes[parent] = fit(indices[parent], level_bounds[lvl]);
+                pos = parent;
+            }
+        }
+
+        ///Calls visitor(box, id) for each item that intersects window at
+        ///some time in [t1, t2] until the visitor returns false; returns
+        ///false if stopped early
+        template<typename Visitor>
+        bool visit(const MBR<T> &window, double t1, double t2, Visitor &&visitor) const {
+            t1 = std::max(t1, time);
+            if (t1 > t2) {
+                return true;
+            }
+            packed::Tree<MovingBox<T>> tree{nodes.data(), indices.data(), level_bounds.data(),
+                                            num_items, level_bounds.size(), node_size};
+            return tree.visit([&](const MovingBox<T> &node) { return node.intersects(window, t1, t2); },
+                              std::forward<Visitor>(visitor));
+        }
+
+        ///Ids of items that intersect window at some time in [t1, t2]
+        std::vector<uint64_t> search(const MBR<T> &window, double t1, double t2) const {
+            std::vector<uint64_t> results;
+            visit(window, t1, t2, [&](const MovingBox<T> &, uint64_t id) {
+                results.push_back(id);
+                return true;
+            });
+            return results;
+        }
+
+        ///Ids of items that intersect window at time t
+        std::vector<uint64_t> search(const MBR<T> &window, double t) const {
+            return search(window, t, t);
+        }
+
+    private:
+        std::vector<uint64_t> leaves;
+
+        static double earliest(const MovingBox<T> *items, std::size_t n) {
+            auto t = n == 0 ? 0.0 : items[0].time;
+            for (std::size_t i = 1; i < n; i++) {
+                t = std::min(t, items[i].time);
+            }
+            return t;
+        }
+
+        ///Node bounding the children starting at first, from time on
+        MovingBox<T> fit(uint64_t first, uint64_t last) const {
+            auto node = nodes[first].rebase(time);
+            auto end = std::min(first + node_size, last);
+            for (auto pos = first + 1; pos < end; pos++) {
+                node.expand_to_include(nodes[pos]);
+            }
+            return node;
+        }
+
+    };
+}
+#endif //MBR_MOVING_H
@@ -3,17 +3,17 @@
 #ifndef MUTIL_MUTIL_H
 #define MUTIL_MUTIL_H
 
-const double PRECISION = 12;
-const double EPSILON = 1.0e-12;
-const double Ln2 = M_LN2;
-const double Sqrt2 = M_SQRT2;
-const double Pi = M_PI;
-const double Tau = 2.0 * Pi;
+constexpr double PRECISION = 12;
+constexpr double EPSILON = 1.0e-12;
+constexpr double Ln2 = M_LN2;
+constexpr double Sqrt2 = M_SQRT2;
+constexpr double Pi = M_PI;
+constexpr double Tau = 2.0 * Pi;
 
 ///Compare two floating point values
 [[using gnu : const, always_inline, hot]]
-inline bool feq(double a, double b, double eps = EPSILON) {
-    return (a == b) || (fabs(a - b) < eps);
+constexpr bool feq(double a, double b, double eps = EPSILON) {
+    return (a == b) || (a - b < eps && b - a < eps);
 }
 
 ///Rounds a float to the nearest whole number float
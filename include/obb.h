@@ -0,0 +1,250 @@
+#include <cmath>
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+#include "../mbr.h"
+#include "pool.h"
+
+#ifndef MBR_OBB_H
+#define MBR_OBB_H
+namespace mbr {
+    ///Rectangle rotated so its width runs along the unit vector axis
+    struct OrientedBox {
+        Pt<double> center;
+        Pt<double> axis;
+        double width;
+        double height;
+
+        [[nodiscard]] double area() const { return width * height; }
+
+        [[nodiscard]] double perimeter() const { return 2 * (width + height); }
+
+        ///Angle of axis from the x axis in radians
+        [[nodiscard]] double angle() const { return std::atan2(axis.y, axis.x); }
+
+        ///Corners counter clockwise
+        [[nodiscard]] std::array<Pt<double>, 4> corners() const {
+            auto ux = axis.x * width / 2, uy = axis.y * width / 2;
+            auto vx = -axis.y * height / 2, vy = axis.x * height / 2;
+            return {Pt<double>{center.x - ux - vx, center.y - uy - vy},
+                    Pt<double>{center.x + ux - vx, center.y + uy - vy},
+                    Pt<double>{center.x + ux + vx, center.y + uy + vy},
+                    Pt<double>{center.x - ux + vx, center.y - uy + vy}};
+        }
+
+        ///Axis aligned bounds
+        [[nodiscard]] MBR<double> envelope() const {
+            auto c = corners();
+            MBR<double> box(c[0]);
+            for (int i = 1; i < 4; i++) {
+                box.expand_to_include(c[i].x, c[i].y);
+            }
+            return box;
+        }
+
+        ///Contains x, y, boundary included within eps
+        [[nodiscard]] bool contains(double x, double y, double eps = 1.0e-9) const {
+            auto dx = x - center.x, dy = y - center.y;
+            auto u = dx * axis.x + dy * axis.y;
+            auto v = -dx * axis.y + dy * axis.x;
+            return std::abs(u) <= width / 2 + eps && std::abs(v) <= height / 2 + eps;
+        }
+    };
+
+    namespace obb {
+        template<typename T>
+        double cross(const Pt<T> &o, const Pt<T> &a, const Pt<T> &b) {
+            return (static_cast<double>(a.x) - o.x) * (static_cast<double>(b.y) - o.y) -
+                   (static_cast<double>(a.y) - o.y) * (static_cast<double>(b.x) - o.x);
+        }
+
+        ///Convex hull of pts in place (Andrew's monotone chain) : pts ends
+        ///up holding the hull counter clockwise without collinear points.
+        ///Points with a NaN or infinite coordinate are dropped first, as
+        ///they would break the ordering the sort relies on.
+        template<typename T>
+        void hull(std::vector<Pt<T>> &pts) {
+            pts.erase(std::remove_if(pts.begin(), pts.end(), [](const Pt<T> &p) {
+                return !(p.x - p.x == 0 && p.y - p.y == 0);
+            }), pts.end());
+            std::sort(pts.begin(), pts.end(), [](const Pt<T> &a, const Pt<T> &b) {
+                return a.x < b.x || (a.x == b.x && a.y < b.y);
+            });
+            pts.erase(std::unique(pts.begin(), pts.end(), [](const Pt<T> &a, const Pt<T> &b) {
+                return a.x == b.x && a.y == b.y;
+            }), pts.end());
+            if (pts.size() < 3) {
+                return;
+            }
+            std::vector<Pt<T>> out(2 * pts.size());
+            std::size_t k = 0;
+            for (auto &p : pts) {
+                while (k >= 2 && cross(out[k - 2], out[k - 1], p) <= 0) {
+                    k--;
+                }
+                out[k++] = p;
+            }
+            auto lower = k + 1;
+            for (auto i = pts.size() - 1; i-- > 0;) {
+                while (k >= lower && cross(out[k - 2], out[k - 1], pts[i]) <= 0) {
+                    k--;
+                }
+                out[k++] = pts[i];
+            }
+            out.resize(k - 1);
+            pts.swap(out);
+        }
+
+        ///Rotating calipers over a counter clockwise hull : calls
+        ///fn(box) with the rectangle flush with each hull edge
+        template<typename T, typename Fn>
+        void calipers(const std::vector<Pt<T>> &hull, Fn &&fn) {
+            auto h = hull.size();
+            auto pt = [&](std::size_t i) {
+                return Pt<double>{static_cast<double>(hull[i % h].x), static_cast<double>(hull[i % h].y)};
+            };
+            auto dot = [](const Pt<double> &a, const Pt<double> &b, const Pt<double> &d) {
+                return (b.x - a.x) * d.x + (b.y - a.y) * d.y;
+            };
+            //a : furthest along the edge, b : furthest from it, c : furthest back
+            std::size_t a = 1, b = 1, c = 1;
+            for (std::size_t i = 0; i < h; i++) {
+                auto p = pt(i), q = pt(i + 1);
+                auto len = std::hypot(q.x - p.x, q.y - p.y);
+                Pt<double> u{(q.x - p.x) / len, (q.y - p.y) / len};
+                Pt<double> v{-u.y, u.x};
+                a = std::max(a, i + 1);
+                while (dot(pt(a), pt(a + 1), u) > 0) {
+                    a++;
+                }
+                b = std::max(b, a);
+                while (dot(pt(b), pt(b + 1), v) > 0) {
+                    b++;
+                }
+                c = std::max(c, b);
+                while (dot(pt(c), pt(c + 1), u) < 0) {
+                    c++;
+                }
+                auto lo = dot(p, pt(c), u), hi = dot(p, pt(a), u);
+                auto height = dot(p, pt(b), v);
+                auto mid = (lo + hi) / 2;
+                fn(OrientedBox{Pt<double>{p.x + u.x * mid + v.x * height / 2, p.y + u.y * mid + v.y * height / 2},
+                               u, hi - lo, height});
+            }
+        }
+
+        ///Smallest rectangle around hull by score(box)
+        template<typename T, typename Score>
+        std::optional<OrientedBox> smallest(const std::vector<Pt<T>> &hull, Score &&score) {
+            if (hull.empty()) {
+                return std::nullopt;
+            }
+            Pt<double> p0{static_cast<double>(hull[0].x), static_cast<double>(hull[0].y)};
+            if (hull.size() == 1) {
+                return OrientedBox{p0, Pt<double>{1, 0}, 0, 0};
+            }
+            if (hull.size() == 2) {
+                Pt<double> p1{static_cast<double>(hull[1].x), static_cast<double>(hull[1].y)};
+                auto len = std::hypot(p1.x - p0.x, p1.y - p0.y);
+                return OrientedBox{Pt<double>{(p0.x + p1.x) / 2, (p0.y + p1.y) / 2},
+                                   Pt<double>{(p1.x - p0.x) / len, (p1.y - p0.y) / len}, len, 0};
+            }
+            std::optional<OrientedBox> best;
+            calipers(hull, [&](const OrientedBox &box) {
+                if (!best || score(box) < score(*best)) {
+                    best = box;
+                }
+            });
+            return best;
+        }
+    }
+
+    ///Convex hull of n points, counter clockwise without collinear
+    ///points; non-finite points are ignored
+    template<typename T>
+    std::vector<Pt<T>> convex_hull(const Pt<T> *pts, std::size_t n) {
+        std::vector<Pt<T>> out(pts, pts + n);
+        obb::hull(out);
+        return out;
+    }
+
+    template<typename T>
+    std::vector<Pt<T>> convex_hull(const std::vector<Pt<T>> &pts) {
+        return convex_hull(pts.data(), pts.size());
+    }
+
+    ///Convex hull of n points : chunks of grain points are reduced to
+    ///their own hulls across pool, then the hull of those is taken
+    template<typename T>
+    std::vector<Pt<T>> convex_hull(const Pt<T> *pts, std::size_t n,
+                                   ThreadPool &pool, std::size_t grain = 1 << 16) {
+        std::vector<std::vector<Pt<T>>> parts(pool.size());
+        pool.parallel_for(n, grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+            auto part = convex_hull(pts + begin, end - begin);
+            parts[worker].insert(parts[worker].end(), part.begin(), part.end());
+        });
+        std::vector<Pt<T>> out;
+        for (auto &part : parts) {
+            out.insert(out.end(), part.begin(), part.end());
+        }
+        obb::hull(out);
+        return out;
+    }
+
+    template<typename T>
+    std::vector<Pt<T>> convex_hull(const std::vector<Pt<T>> &pts, ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return convex_hull(pts.data(), pts.size(), pool, grain);
+    }
+
+    ///Minimum area rectangle around n points (rotating calipers over the
+    ///convex hull), empty if there are no finite points
+    template<typename T>
+    std::optional<OrientedBox> min_area_rect(const Pt<T> *pts, std::size_t n) {
+        return obb::smallest(convex_hull(pts, n), [](const OrientedBox &b) { return b.area(); });
+    }
+
+    template<typename T>
+    std::optional<OrientedBox> min_area_rect(const std::vector<Pt<T>> &pts) {
+        return min_area_rect(pts.data(), pts.size());
+    }
+
+    ///Minimum area rectangle around n points, with the hull built across pool
+    template<typename T>
+    std::optional<OrientedBox> min_area_rect(const Pt<T> *pts, std::size_t n,
+                                             ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return obb::smallest(convex_hull(pts, n, pool, grain), [](const OrientedBox &b) { return b.area(); });
+    }
+
+    template<typename T>
+    std::optional<OrientedBox> min_area_rect(const std::vector<Pt<T>> &pts, ThreadPool &pool,
+                                             std::size_t grain = 1 << 16) {
+        return min_area_rect(pts.data(), pts.size(), pool, grain);
+    }
+
+    ///Minimum perimeter rectangle around n points, empty if there are no finite points
+    template<typename T>
+    std::optional<OrientedBox> min_perimeter_rect(const Pt<T> *pts, std::size_t n) {
+        return obb::smallest(convex_hull(pts, n), [](const OrientedBox &b) { return b.perimeter(); });
+    }
+
+    template<typename T>
+    std::optional<OrientedBox> min_perimeter_rect(const std::vector<Pt<T>> &pts) {
+        return min_perimeter_rect(pts.data(), pts.size());
+    }
+
+    ///Minimum perimeter rectangle around n points, with the hull built across pool
+    template<typename T>
+    std::optional<OrientedBox> min_perimeter_rect(const Pt<T> *pts, std::size_t n,
+                                                  ThreadPool &pool, std::size_t grain = 1 << 16) {
+        return obb::smallest(convex_hull(pts, n, pool, grain), [](const OrientedBox &b) { return b.perimeter(); });
+    }
+
+    template<typename T>
+    std::optional<OrientedBox> min_perimeter_rect(const std::vector<Pt<T>> &pts, ThreadPool &pool,
+                                                  std::size_t grain = 1 << 16) {
+        return min_perimeter_rect(pts.data(), pts.size(), pool, grain);
+    }
+}
+#endif //MBR_OBB_H
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#ifndef MBR_POOL_H
+#define MBR_POOL_H
+namespace mbr {
+    ///Fixed set of worker threads running parallel loops. Each worker
+    ///starts on its own contiguous share of the range and, once that is
+    ///drained, steals chunks from the shares of the other workers.
+    struct ThreadPool {
+        ///threads includes the calling thread, which takes part in every loop
+        explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) :
+                shares(std::max<std::size_t>(threads, 1)) {
+            for (std::size_t w = 1; w < shares.size(); w++) {
+                workers.emplace_back([this, w] { work(w); });
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto &t : workers) {
+                t.join();
+            }
+        }
+
+        ///Number of threads taking part in a loop
+        [[nodiscard]] std::size_t size() const { return shares.size(); }
+
+        ///Calls fn(begin, end, worker) over chunks of at most grain items
+        ///covering [0, n); returns when all chunks are done. If fn throws,
+        ///no further chunks are started and the first exception is
+        ///rethrown once every thread has left the loop. Only one thread
+        ///may run a loop on a pool at a time, and fn must not start
+        ///another loop on the same pool.
+        template<typename Fn>
+        void parallel_for(std::size_t n, std::size_t grain, Fn &&fn) {
+            if (n == 0) {
+                return;
+            }
+            grain = std::max<std::size_t>(grain, 1);
+            if (size() == 1 || n <= grain) {
+                fn(std::size_t{0}, n, std::size_t{0});
+                return;
+            }
+            auto per = (n + size() - 1) / size();
+            for (std::size_t w = 0; w < size(); w++) {
+                shares[w].next.store(std::min(w * per, n), std::memory_order_relaxed);
+                shares[w].end = std::min((w + 1) * per, n);
+            }
+            failed.store(false, std::memory_order_relaxed);
+            auto run = [&](std::size_t worker) {
+                try {
+                    drain(worker, grain, fn);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            };
+            std::unique_lock<std::mutex> lock(mutex);
+            task = run;
+            running = size() - 1;
+            generation++;
+            lock.unlock();
+            wake.notify_all();
+
+            run(0);
+
+            lock.lock();
+            done.wait(lock, [&] { return running == 0; });
+            task = nullptr;
+            auto first = std::move(error);
+            error = nullptr;
+            lock.unlock();
+            if (first) {
+                std::rethrow_exception(first);
+            }
+        }
+
+    private:
+        struct alignas(64) Share {
+            std::atomic<std::size_t> next{0};
+            std::size_t end = 0;
+        };
+
+        std::vector<Share> shares;
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::function<void(std::size_t)> task;
+        std::size_t running = 0;
+        uint64_t generation = 0;
+        std::exception_ptr error;
+        std::atomic<bool> failed{false};
+        bool stop = false;
+
+        template<typename Fn>
+        void drain(std::size_t worker, std::size_t grain, Fn &fn) {
+            for (std::size_t i = 0; i < size(); i++) {
+                auto &share = shares[(worker + i) % size()];
+                while (!failed.load(std::memory_order_relaxed)) {
+                    auto begin = share.next.fetch_add(grain, std::memory_order_relaxed);
+                    if (begin >= share.end) {
+                        break;
+                    }
+                    fn(begin, std::min(begin + grain, share.end), worker);
+                }
+            }
+        }
+
+        void work(std::size_t worker) {
+            uint64_t seen = 0;
+            while (true) {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+                auto job = task;
+                lock.unlock();
+
+                job(worker);
+
+                lock.lock();
+                if (--running == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    };
+}
+#endif //MBR_POOL_H
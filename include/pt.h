@@ -11,22 +11,22 @@ struct Pt {
     T y;
 
     ///Operator : equals
-    inline bool equals(const Pt<T> &other) {
+    constexpr bool equals(const Pt<T> &other) const {
         return feq(x, other.x) && feq(y, other.y);
     }
 
     ///Operator : equals
-    inline bool operator==(const Pt<T> &other) {
+    constexpr bool operator==(const Pt<T> &other) const {
         return equals(other);
     }
 
     ///Operator : not equal
-    inline bool operator!=(const Pt<T> &other) {
+    constexpr bool operator!=(const Pt<T> &other) const {
         return !equals(other);
     }
 
     ///As Array
-    std::array<T, 2> as_array() {
+    constexpr std::array<T, 2> as_array() const {
         return {x, y};
     }
 };
@@ -38,22 +38,22 @@ struct Pt3d {
     T z;
 
     ///Operator : equals
-    inline bool equals(const Pt3d<T> &other) {
+    constexpr bool equals(const Pt3d<T> &other) const {
         return feq(x, other.x) && feq(y, other.y) && feq(z, other.z);
     }
 
     ///Operator : equals
-    inline bool operator==(const Pt3d<T> &other) {
+    constexpr bool operator==(const Pt3d<T> &other) const {
         return equals(other);
     }
 
     ///Operator : not equal
-    inline bool operator!=(const Pt3d<T> &other) {
+    constexpr bool operator!=(const Pt3d<T> &other) const {
         return !equals(other);
     }
 
     ///As Array
-    std::array<T, 3> as_array() {
+    constexpr std::array<T, 3> as_array() const {
         return {x, y, z};
     }
 };
@@ -0,0 +1,228 @@
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include "index.h"
+#include "clip.h"
+
+#ifndef MBR_RAY_H
+#define MBR_RAY_H
+namespace mbr {
+    ///Ray origin + t * dir for t in [0, tmax]; dir need not be unit
+    ///length, so a segment a b is the ray {a, b - a, 1}
+    template<typename T>
+    struct Ray {
+        Pt<T> origin;
+        Pt<T> dir;
+        double tmax = std::numeric_limits<double>::infinity();
+
+        ///Point at parameter t
+        [[nodiscard]] constexpr Pt<double> at(double t) const {
+            return Pt<double>{origin.x + t * dir.x, origin.y + t * dir.y};
+        }
+    };
+
+    ///Parameters where a ray enters and leaves a box
+    struct RayHit {
+        double enter;
+        double exit;
+    };
+
+    ///Item hit by a ray cast through an index
+    struct RayItem {
+        uint64_t id;
+        RayHit hit;
+    };
+
+    ///Slab test of ray against box, empty if the ray misses it
+    template<typename T>
+    std::optional<RayHit> ray_box(const Ray<T> &ray, const MBR<T> &box) {
+        double t0 = 0, t1 = ray.tmax;
+        clip::slab<double>(static_cast<double>(ray.origin.x), static_cast<double>(ray.dir.x),
+                           static_cast<double>(box.minx), static_cast<double>(box.maxx), t0, t1);
+        clip::slab<double>(static_cast<double>(ray.origin.y), static_cast<double>(ray.dir.y),
+                           static_cast<double>(box.miny), static_cast<double>(box.maxy), t0, t1);
+        if (!(t0 <= t1)) {
+            return std::nullopt;
+        }
+        return RayHit{t0, t1};
+    }
+
+    ///One ray against n boxes, a vector of boxes per step : sets hits[i]
+    ///and, where it is 1, enter[i] and exit[i]. Returns the number of hits.
+    template<typename T>
+    std::size_t ray_boxes(const Ray<T> &ray, const MBR<T> *boxes, std::size_t n,
+                          T *enter, T *exit, uint8_t *hits) {
+        static_assert(std::is_floating_point<T>::value, "batch ray tests need floating point coordinates");
+        using Vec = typename clip::Lanes<T>::Vec;
+        constexpr auto N = clip::Lanes<T>::N;
+        Vec zero{};
+        Vec ox = zero + ray.origin.x, oy = zero + ray.origin.y;
+        Vec dx = zero + ray.dir.x, dy = zero + ray.dir.y;
+        std::size_t count = 0;
+        std::size_t i = 0;
+        for (; i + N <= n; i += N) {
+            Vec minx{}, miny{}, maxx{}, maxy{};
+            for (std::size_t j = 0; j < N; j++) {
+                minx[j] = boxes[i + j].minx;
+                miny[j] = boxes[i + j].miny;
+                maxx[j] = boxes[i + j].maxx;
+                maxy[j] = boxes[i + j].maxy;
+            }
+            Vec t0 = zero, t1 = zero + static_cast<T>(ray.tmax);
+            clip::slab<T>(ox, dx, minx, maxx, t0, t1);
+            clip::slab<T>(oy, dy, miny, maxy, t0, t1);
+            auto hit = t0 <= t1;
+            for (std::size_t j = 0; j < N; j++) {
+                enter[i + j] = t0[j];
+                exit[i + j] = t1[j];
+                hits[i + j] = hit[j] != 0;
+                count += hit[j] != 0;
+            }
+        }
+        for (; i < n; i++) {
+            T t0 = 0, t1 = static_cast<T>(ray.tmax);
+            clip::slab<T>(ray.origin.x, ray.dir.x, boxes[i].minx, boxes[i].maxx, t0, t1);
+            clip::slab<T>(ray.origin.y, ray.dir.y, boxes[i].miny, boxes[i].maxy, t0, t1);
+            enter[i] = t0;
+            exit[i] = t1;
+            hits[i] = t0 <= t1;
+            count += t0 <= t1;
+        }
+        return count;
+    }
+
+    ///Packet of n rays, as origin and direction columns sharing tmax,
+    ///against one box : sets hits[i] and, where it is 1, enter[i] and
+    ///exit[i]. Returns the number of hits.
+    template<typename T>
+    std::size_t rays_box(const T *ox, const T *oy, const T *dx, const T *dy, std::size_t n,
+                         const MBR<T> &box, T *enter, T *exit, uint8_t *hits,
+                         T tmax = std::numeric_limits<T>::infinity()) {
+        static_assert(std::is_floating_point<T>::value, "batch ray tests need floating point coordinates");
+        using Vec = typename clip::Lanes<T>::Vec;
+        constexpr auto N = clip::Lanes<T>::N;
+        std::size_t count = 0;
+        std::size_t i = 0;
+        for (; i + N <= n; i += N) {
+            Vec px{}, py{}, vx{}, vy{};
+            for (std::size_t j = 0; j < N; j++) {
+                px[j] = ox[i + j];
+                py[j] = oy[i + j];
+                vx[j] = dx[i + j];
+                vy[j] = dy[i + j];
+            }
+            Vec t0{}, t1 = t0 + tmax;
+            clip::slab<T>(px, vx, box.minx, box.maxx, t0, t1);
+            clip::slab<T>(py, vy, box.miny, box.maxy, t0, t1);
+            auto hit = t0 <= t1;
+            for (std::size_t j = 0; j < N; j++) {
+                enter[i + j] = t0[j];
+                exit[i + j] = t1[j];
+                hits[i + j] = hit[j] != 0;
+                count += hit[j] != 0;
+            }
+        }
+        for (; i < n; i++) {
+            T t0 = 0, t1 = tmax;
+            clip::slab<T>(ox[i], dx[i], box.minx, box.maxx, t0, t1);
+            clip::slab<T>(oy[i], dy[i], box.miny, box.maxy, t0, t1);
+            enter[i] = t0;
+            exit[i] = t1;
+            hits[i] = t0 <= t1;
+            count += t0 <= t1;
+        }
+        return count;
+    }
+
+    ///Casts ray through index, calling visitor(item) for the items whose
+    ///box it hits in order of entry until the visitor returns false;
+    ///returns false if stopped early. Nodes are opened best first by
+    ///entry parameter, so stopping after the first hits skips the rest.
+    template<typename T, typename Visitor>
+    bool raycast(const IndexView<T> &index, const Ray<T> &ray, Visitor &&visitor) {
+        if (index.empty()) {
+            return true;
+        }
+        //entries hold node positions; leaf entries are leaf positions.
+        //The per thread heap is taken out for the cast and put back after,
+        //also when the visitor throws, so a visitor that casts again gets
+        //a heap of its own.
+        struct Borrow {
+            std::vector<Neighbor> heap;
+
+            Borrow() { heap.swap(QueryScratch::local().rays); }
+
+            ~Borrow() { heap.swap(QueryScratch::local().rays); }
+        } borrow;
+        auto &heap = borrow.heap;
+        heap.clear();
+        auto push = [&](double enter, uint64_t pos, bool leaf) {
+            heap.push_back({enter, pos, leaf});
+            std::push_heap(heap.begin(), heap.end(), std::greater<Neighbor>{});
+        };
+        auto root = index.num_nodes - 1;
+        if (auto hit = ray_box(ray, index.boxes[root])) {
+            push(hit->enter, root, false);
+        }
+        bool complete = true;
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<Neighbor>{});
+            auto top = heap.back();
+            heap.pop_back();
+            if (top.leaf) {
+                auto hit = ray_box(ray, index.boxes[top.id]);
+                if (!visitor(RayItem{index.indices[top.id], *hit})) {
+                    complete = false;
+                    break;
+                }
+                continue;
+            }
+            auto first = index.indices[top.id];
+            auto end = std::min(first + index.node_size, index.level_end(first));
+            for (auto pos = first; pos < end; pos++) {
+                if (auto hit = ray_box(ray, index.boxes[pos])) {
+                    push(hit->enter, pos, first < index.num_items);
+                }
+            }
+        }
+        return complete;
+    }
+
+    template<typename T, typename Visitor>
+    bool raycast(const Index<T> &index, const Ray<T> &ray, Visitor &&visitor) {
+        return raycast(index.view(), ray, std::forward<Visitor>(visitor));
+    }
+
+    ///Item whose box the ray enters first, e.g. for picking
+    template<typename T>
+    std::optional<RayItem> first_hit(const IndexView<T> &index, const Ray<T> &ray) {
+        std::optional<RayItem> found;
+        raycast(index, ray, [&](const RayItem &item) {
+            found = item;
+            return false;
+        });
+        return found;
+    }
+
+    template<typename T>
+    std::optional<RayItem> first_hit(const Index<T> &index, const Ray<T> &ray) {
+        return first_hit(index.view(), ray);
+    }
+
+    ///Checks that segment a b crosses no box of index
+    template<typename T>
+    bool line_of_sight(const IndexView<T> &index, const Pt<T> &a, const Pt<T> &b) {
+        return !first_hit(index, Ray<T>{a, Pt<T>{b.x - a.x, b.y - a.y}, 1.0}).has_value();
+    }
+
+    template<typename T>
+    bool line_of_sight(const Index<T> &index, const Pt<T> &a, const Pt<T> &b) {
+        return line_of_sight(index.view(), a, b);
+    }
+}
+#endif //MBR_RAY_H
@@ -0,0 +1,268 @@
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "index.h"
+
+#ifndef MBR_SHM_H
+#define MBR_SHM_H
+namespace mbr {
+    ///Control segment shared by a publisher and its readers;
+    ///generation names the live data segment `<name>.<generation>`
+    struct ShmControl {
+        std::atomic<uint64_t> generation;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    ///Header at the start of a data segment, followed by the
+    ///level bounds, boxes and indices arrays of a packed index
+    struct ShmHeader {
+        uint64_t magic;
+        uint64_t box_size;
+        uint64_t generation;
+        uint64_t num_items;
+        uint64_t num_nodes;
+        uint64_t num_levels;
+        uint64_t node_size;
+        uint64_t bounds_offset;
+        uint64_t boxes_offset;
+        uint64_t indices_offset;
+        uint64_t size;
+    };
+
+    constexpr uint64_t SHM_MAGIC = 0x31304d485352424d; // "MBRSHM01"
+
+    namespace shm {
+        inline std::string data_name(const std::string &name, uint64_t generation) {
+            return name + "." + std::to_string(generation);
+        }
+
+        inline uint64_t align(uint64_t offset, uint64_t to = 64) {
+            return (offset + to - 1) / to * to;
+        }
+
+        ///Throws err, saved by the caller before any cleanup could clobber errno
+        [[noreturn]] inline void fail(int err, const std::string &what) {
+            throw std::system_error(err, std::generic_category(), what);
+        }
+
+        ///Maps a whole shared memory object, closing fd
+        inline void *map(int fd, std::size_t size, int prot, const std::string &name) {
+            auto ptr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+            auto err = errno;
+            close(fd);
+            if (ptr == MAP_FAILED) {
+                fail(err, "mmap " + name);
+            }
+            return ptr;
+        }
+    }
+
+    ///Publishes packed indexes into POSIX shared memory.
+    ///Each publish writes a new generation segment and then swaps the
+    ///control generation atomically; the previous segment is unlinked,
+    ///readers still attached to it keep their mapping until they refresh.
+    template<typename T>
+    struct ShmPublisher {
+        explicit ShmPublisher(std::string name) : name(std::move(name)) {
+            auto fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0) {
+                shm::fail(errno, "shm_open " + this->name);
+            }
+            if (ftruncate(fd, sizeof(ShmControl)) != 0) {
+                auto err = errno;
+                close(fd);
+                shm::fail(err, "ftruncate " + this->name);
+            }
+            control = static_cast<ShmControl *>(shm::map(
+                    fd, sizeof(ShmControl), PROT_READ | PROT_WRITE, this->name));
+        }
+
+        ShmPublisher(const ShmPublisher &) = delete;
+
+        ShmPublisher &operator=(const ShmPublisher &) = delete;
+
+        ~ShmPublisher() {
+            munmap(control, sizeof(ShmControl));
+        }
+
+        ///Current published generation, 0 if nothing is published
+        [[nodiscard]] uint64_t generation() const {
+            return control->generation.load(std::memory_order_acquire);
+        }
+
+        ///Writes index into a new generation and makes it live
+        uint64_t publish(const Index<T> &index) {
+            auto view = index.view();
+            auto prev = generation();
+            auto gen = prev + 1;
+
+            ShmHeader header{};
+            header.magic = SHM_MAGIC;
+            header.box_size = sizeof(MBR<T>);
+            header.generation = gen;
+            header.num_items = view.num_items;
+            header.num_nodes = view.num_nodes;
+            header.num_levels = view.num_levels;
+            header.node_size = view.node_size;
+            header.bounds_offset = shm::align(sizeof(ShmHeader));
+            header.boxes_offset = shm::align(header.bounds_offset + view.num_levels * sizeof(uint64_t));
+            header.indices_offset = shm::align(header.boxes_offset + view.num_nodes * sizeof(MBR<T>));
+            header.size = header.indices_offset + view.num_nodes * sizeof(uint64_t);
+
+            auto dname = shm::data_name(name, gen);
+            auto fd = shm_open(dname.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (fd < 0 && errno == EEXIST) {
+                //left behind by a publisher that died before making it live
+                shm_unlink(dname.c_str());
+                fd = shm_open(dname.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            }
+            if (fd < 0) {
+                shm::fail(errno, "shm_open " + dname);
+            }
+            if (ftruncate(fd, static_cast<off_t>(header.size)) != 0) {
+                auto err = errno;
+                close(fd);
+                shm_unlink(dname.c_str());
+                shm::fail(err, "ftruncate " + dname);
+            }
+            char *base;
+            try {
+                base = static_cast<char *>(shm::map(fd, header.size, PROT_READ | PROT_WRITE, dname));
+            }
+            catch (...) {
+                shm_unlink(dname.c_str());
+                throw;
+            }
+            std::memcpy(base, &header, sizeof(ShmHeader));
+            if (!view.empty()) {
+                std::memcpy(base + header.bounds_offset, view.level_bounds, view.num_levels * sizeof(uint64_t));
+                std::memcpy(base + header.boxes_offset, view.boxes, view.num_nodes * sizeof(MBR<T>));
+                std::memcpy(base + header.indices_offset, view.indices, view.num_nodes * sizeof(uint64_t));
+            }
+            munmap(base, header.size);
+
+            control->generation.store(gen, std::memory_order_release);
+            if (prev != 0) {
+                shm_unlink(shm::data_name(name, prev).c_str());
+            }
+            return gen;
+        }
+
+        ///Removes the control and live data segment names
+        void unlink() {
+            auto gen = generation();
+            if (gen != 0) {
+                shm_unlink(shm::data_name(name, gen).c_str());
+            }
+            shm_unlink(name.c_str());
+        }
+
+    private:
+        std::string name;
+        ShmControl *control = nullptr;
+    };
+
+    ///Read-only attachment to an index published by ShmPublisher
+    template<typename T>
+    struct ShmReader {
+        explicit ShmReader(std::string name) : name(std::move(name)) {
+            auto fd = shm_open(this->name.c_str(), O_RDONLY, 0);
+            if (fd < 0) {
+                shm::fail(errno, "shm_open " + this->name);
+            }
+            control = static_cast<const ShmControl *>(shm::map(
+                    fd, sizeof(ShmControl), PROT_READ, this->name));
+            refresh();
+        }
+
+        ShmReader(const ShmReader &) = delete;
+
+        ShmReader &operator=(const ShmReader &) = delete;
+
+        ~ShmReader() {
+            detach();
+            munmap(const_cast<ShmControl *>(control), sizeof(ShmControl));
+        }
+
+        ///Generation currently attached, 0 if none
+        [[nodiscard]] uint64_t generation() const {
+            return header ? header->generation : 0;
+        }
+
+        ///Attaches the live generation if it changed;
+        ///views taken before a swap are invalidated
+        bool refresh() {
+            while (true) {
+                auto gen = control->generation.load(std::memory_order_acquire);
+                if (gen == generation()) {
+                    return false;
+                }
+                auto dname = shm::data_name(name, gen);
+                auto fd = shm_open(dname.c_str(), O_RDONLY, 0);
+                if (fd < 0) {
+                    //publisher swapped and unlinked it in between, retry
+                    if (errno == ENOENT && gen != control->generation.load(std::memory_order_acquire)) {
+                        continue;
+                    }
+                    shm::fail(errno, "shm_open " + dname);
+                }
+                struct stat st{};
+                if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ShmHeader)) {
+                    close(fd);
+                    throw std::runtime_error("invalid index segment " + dname);
+                }
+                auto base = shm::map(fd, st.st_size, PROT_READ, dname);
+                auto hdr = static_cast<const ShmHeader *>(base);
+                if (hdr->magic != SHM_MAGIC || hdr->box_size != sizeof(MBR<T>) ||
+                    hdr->size > static_cast<uint64_t>(st.st_size)) {
+                    munmap(base, st.st_size);
+                    throw std::runtime_error("invalid index segment " + dname);
+                }
+                detach();
+                header = hdr;
+                mapped = st.st_size;
+                return true;
+            }
+        }
+
+        [[nodiscard]] IndexView<T> view() const {
+            if (!header) {
+                return IndexView<T>{};
+            }
+            auto base = reinterpret_cast<const char *>(header);
+            return IndexView<T>{
+                    reinterpret_cast<const MBR<T> *>(base + header->boxes_offset),
+                    reinterpret_cast<const uint64_t *>(base + header->indices_offset),
+                    reinterpret_cast<const uint64_t *>(base + header->bounds_offset),
+                    header->num_items, header->num_nodes, header->num_levels, header->node_size,
+            };
+        }
+
+        ///Ids of items whose box intersects query
+        std::vector<uint64_t> search(const MBR<T> &query) const {
+            return view().search(query);
+        }
+
+    private:
+        std::string name;
+        const ShmControl *control = nullptr;
+        const ShmHeader *header = nullptr;
+        std::size_t mapped = 0;
+
+        void detach() {
+            if (header) {
+                munmap(const_cast<ShmHeader *>(header), mapped);
+                header = nullptr;
+                mapped = 0;
+            }
+        }
+    };
+}
+#endif //MBR_SHM_H
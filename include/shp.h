@@ -0,0 +1,186 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "../mbr.h"
+#include "index.h"
+#include "mmap.h"
+
+#ifndef MBR_SHP_H
+#define MBR_SHP_H
+namespace mbr {
+    namespace shp {
+        constexpr int32_t FILE_CODE = 9994;
+        constexpr std::size_t HEADER_SIZE = 100;
+        constexpr std::size_t RECORD_HEADER_SIZE = 8;
+
+        inline uint32_t be32(const char *p) {
+            auto b = reinterpret_cast<const uint8_t *>(p);
+            return (uint32_t{b[0]} << 24) | (uint32_t{b[1]} << 16) | (uint32_t{b[2]} << 8) | b[3];
+        }
+
+        inline int32_t le32(const char *p) {
+            auto b = reinterpret_cast<const uint8_t *>(p);
+            return static_cast<int32_t>((uint32_t{b[3]} << 24) | (uint32_t{b[2]} << 16) |
+                                        (uint32_t{b[1]} << 8) | b[0]);
+        }
+
+        inline double le64(const char *p) {
+            uint64_t u = 0;
+            for (int i = 7; i >= 0; i--) {
+                u = (u << 8) | reinterpret_cast<const uint8_t *>(p)[i];
+            }
+            double v;
+            std::memcpy(&v, &u, sizeof(v));
+            return v;
+        }
+
+        inline bool is_point(int32_t type) {
+            return type == 1 || type == 11 || type == 21;
+        }
+
+        [[noreturn]] inline void fail(const std::string &what, const std::string &path) {
+            throw std::runtime_error(what + " in " + path);
+        }
+
+        ///Box of the record content at p of len bytes read from its
+        ///header fields only, false for a null shape
+        inline bool record_box(const char *p, std::size_t len, MBR<double> &out) {
+            if (len < 4) {
+                return false;
+            }
+            auto type = le32(p);
+            if (type == 0) {
+                return false;
+            }
+            if (is_point(type)) {
+                if (len < 20) {
+                    return false;
+                }
+                auto x = le64(p + 4), y = le64(p + 12);
+                out = MBR<double>{x, y, x, y, true};
+                return true;
+            }
+            if (len < 36) {
+                return false;
+            }
+            out = MBR<double>{le64(p + 4), le64(p + 12), le64(p + 20), le64(p + 28), true};
+            return true;
+        }
+    }
+
+    ///Record boxes of a shapefile with the 0-based record number of each
+    struct ShpBoxes {
+        std::vector<MBR<double>> boxes;
+        std::vector<uint64_t> records;
+
+        ///Bulk loads an index over boxes; item ids index into records
+        [[nodiscard]] Index<double> index(uint64_t node_size = 16) const {
+            return Index<double>(boxes, node_size);
+        }
+    };
+
+    ///Memory mapped .shp reader that yields the bounding box of each
+    ///record from its header without touching vertices. Records are
+    ///located through the .shx index when present, otherwise by walking
+    ///record headers.
+    struct ShpFile {
+        explicit ShpFile(const std::string &shp_path) :
+                ShpFile(shp_path, sibling_shx(shp_path)) {}
+
+        ///shx_path may be empty to walk the .shp record headers
+        ShpFile(const std::string &shp_path, const std::string &shx_path) : path(shp_path) {
+            shp = std::make_unique<MappedFile>(shp_path, shx_path.empty() ? MADV_NORMAL : MADV_RANDOM);
+            check_header(*shp, shp_path);
+            if (!shx_path.empty()) {
+                shx = std::make_unique<MappedFile>(shx_path);
+                check_header(*shx, shx_path);
+            }
+            auto h = shp->data();
+            shape_type = shp::le32(h + 32);
+            bounds = MBR<double>{shp::le64(h + 36), shp::le64(h + 44),
+                                 shp::le64(h + 52), shp::le64(h + 60), true};
+        }
+
+        ///Shape type of the file header
+        int32_t shape_type = 0;
+        ///Bounds of the file header
+        MBR<double> bounds;
+
+        [[nodiscard]] bool has_shx() const { return shx != nullptr; }
+
+        ///Calls fn(record, box) for every non null record
+        template<typename Fn>
+        void scan(Fn &&fn) const {
+            auto base = shp->data();
+            auto size = shp->size();
+            MBR<double> box;
+            if (shx) {
+                auto n = (shx->size() - shp::HEADER_SIZE) / shp::RECORD_HEADER_SIZE;
+                auto idx = shx->data() + shp::HEADER_SIZE;
+                for (std::size_t i = 0; i < n; i++, idx += shp::RECORD_HEADER_SIZE) {
+                    auto offset = std::size_t{shp::be32(idx)} * 2;
+                    auto len = std::size_t{shp::be32(idx + 4)} * 2;
+                    if (offset + shp::RECORD_HEADER_SIZE + len > size) {
+                        shp::fail("record " + std::to_string(i) + " out of bounds", path);
+                    }
+                    if (shp::record_box(base + offset + shp::RECORD_HEADER_SIZE, len, box)) {
+                        fn(static_cast<uint64_t>(i), box);
+                    }
+                }
+                return;
+            }
+            std::size_t pos = shp::HEADER_SIZE;
+            for (uint64_t i = 0; pos + shp::RECORD_HEADER_SIZE <= size; i++) {
+                auto len = std::size_t{shp::be32(base + pos + 4)} * 2;
+                pos += shp::RECORD_HEADER_SIZE;
+                if (pos + len > size) {
+                    shp::fail("record " + std::to_string(i) + " out of bounds", path);
+                }
+                if (shp::record_box(base + pos, len, box)) {
+                    fn(i, box);
+                }
+                pos += len;
+            }
+        }
+
+        ///Boxes of all non null records
+        [[nodiscard]] ShpBoxes boxes() const {
+            ShpBoxes out;
+            if (shx) {
+                auto n = (shx->size() - shp::HEADER_SIZE) / shp::RECORD_HEADER_SIZE;
+                out.boxes.reserve(n);
+                out.records.reserve(n);
+            }
+            scan([&](uint64_t record, const MBR<double> &box) {
+                out.boxes.push_back(box);
+                out.records.push_back(record);
+            });
+            return out;
+        }
+
+    private:
+        std::string path;
+        std::unique_ptr<MappedFile> shp;
+        std::unique_ptr<MappedFile> shx;
+
+        static std::string sibling_shx(const std::string &shp_path) {
+            auto dot = shp_path.find_last_of('.');
+            if (dot == std::string::npos || shp_path.find('/', dot) != std::string::npos) {
+                return {};
+            }
+            auto shx_path = shp_path.substr(0, dot + 1) + (shp_path[dot + 1] == 'S' ? "SHX" : "shx");
+            return access(shx_path.c_str(), R_OK) == 0 ? shx_path : std::string{};
+        }
+
+        static void check_header(const MappedFile &file, const std::string &path) {
+            if (file.size() < shp::HEADER_SIZE || shp::be32(file.data()) != shp::FILE_CODE) {
+                shp::fail("invalid shapefile header", path);
+            }
+        }
+    };
+}
+#endif //MBR_SHP_H
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "index.h"
+
+#ifndef MBR_SNAPSHOT_H
+#define MBR_SNAPSHOT_H
+namespace mbr {
+    ///Index published as immutable snapshots through an atomic pointer.
+    ///Readers never lock: each reader thread owns a slot where it records
+    ///the epoch it pinned. A single writer swaps in new snapshots and
+    ///frees retired ones once no pinned reader can still see them.
+    template<typename T>
+    struct SnapshotIndex {
+        static constexpr uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+
+        struct Slot;
+
+        explicit SnapshotIndex(Index<T> index = Index<T>{}, std::size_t max_readers = 128) :
+                num_slots(max_readers), slots(new Slot[max_readers]) {
+            current.store(new Index<T>(std::move(index)));
+        }
+
+        SnapshotIndex(const SnapshotIndex &) = delete;
+
+        SnapshotIndex &operator=(const SnapshotIndex &) = delete;
+
+        ///Requires that no reader is pinned
+        ~SnapshotIndex() {
+            delete current.load();
+            for (auto &r : retired) {
+                delete r.index;
+            }
+        }
+
+        ///Reader bound to one slot, to be used by a single thread
+        struct Reader {
+            Reader(const Reader &) = delete;
+
+            Reader &operator=(const Reader &) = delete;
+
+            Reader(Reader &&other) noexcept : owner(other.owner), slot(other.slot) {
+                other.slot = nullptr;
+            }
+
+            ~Reader() {
+                if (slot) {
+                    slot->used.store(false, std::memory_order_release);
+                }
+            }
+
+            ///Calls fn with the current snapshot, which stays alive for the call
+            template<typename Fn>
+            auto read(Fn &&fn) const {
+                slot->epoch.store(owner->epoch.load());
+                struct Unpin {
+                    Slot *slot;
+
+                    ~Unpin() { slot->epoch.store(IDLE, std::memory_order_release); }
+                } unpin{slot};
+                return fn(static_cast<const Index<T> &>(*owner->current.load()));
+            }
+
+            ///Ids of items whose box intersects query
+            std::vector<uint64_t> search(const MBR<T> &query) const {
+                return read([&](const Index<T> &index) { return index.search(query); });
+            }
+
+        private:
+            friend struct SnapshotIndex;
+            const SnapshotIndex *owner;
+            Slot *slot;
+
+            Reader(const SnapshotIndex *owner, Slot *slot) : owner(owner), slot(slot) {}
+        };
+
+        ///Claims a reader slot; throws if all max_readers slots are taken
+        Reader reader() const {
+            for (std::size_t i = 0; i < num_slots; i++) {
+                bool expected = false;
+                if (!slots[i].used.load(std::memory_order_relaxed) &&
+                    slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return Reader(this, &slots[i]);
+                }
+            }
+            throw std::length_error("no free snapshot reader slot");
+        }
+
+        ///Ids of items whose box intersects query, through a temporary reader
+        std::vector<uint64_t> search(const MBR<T> &query) const {
+            return reader().search(query);
+        }
+
+        ///Writer : makes index the current snapshot and reclaims
+        ///retired snapshots no reader can still hold
+        void publish(Index<T> index) {
+            auto old = current.exchange(new Index<T>(std::move(index)));
+            retired.push_back({old, epoch.fetch_add(1)});
+            reclaim();
+        }
+
+        ///Writer : frees retired snapshots older than every pinned reader
+        void reclaim() {
+            auto oldest = IDLE;
+            for (std::size_t i = 0; i < num_slots; i++) {
+                oldest = std::min(oldest, slots[i].epoch.load());
+            }
+            auto keep = retired.begin();
+            for (auto &r : retired) {
+                if (r.epoch < oldest) {
+                    delete r.index;
+                }
+                else {
+                    *keep++ = r;
+                }
+            }
+            retired.erase(keep, retired.end());
+        }
+
+        ///Writer : number of snapshots waiting to be reclaimed
+        [[nodiscard]] std::size_t pending() const { return retired.size(); }
+
+        ///Per reader epoch, on its own cache line
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{IDLE};
+            std::atomic<bool> used{false};
+        };
+
+    private:
+        struct Retired {
+            const Index<T> *index;
+            uint64_t epoch;
+        };
+
+        std::atomic<const Index<T> *> current{nullptr};
+        std::atomic<uint64_t> epoch{0};
+        std::size_t num_slots;
+        std::unique_ptr<Slot[]> slots;
+        std::vector<Retired> retired;
+    };
+}
+#endif //MBR_SNAPSHOT_H
@@ -0,0 +1,199 @@
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "index.h"
+
+#ifndef MBR_STATIC_INDEX_H
+#define MBR_STATIC_INDEX_H
+namespace mbr {
+    ///Packed Hilbert R-tree over a fixed list of boxes, built entirely at
+    ///compile time when declared constexpr so it lives in read-only data.
+    ///The tree is implicit: children of node j sit at positions
+    ///[j * B, j * B + B) of the level below, so there are no child
+    ///pointers, and traversal is expanded per level by the compiler.
+    ///Item ids are positions in the input array.
+    template<typename T, std::size_t N, std::size_t B = 8>
+    struct StaticIndex {
+        static_assert(N > 0, "static index needs at least one box");
+        static_assert(B > 1, "node size must be at least 2");
+
+        ///Number of levels, leaves are level 0
+        static constexpr std::size_t num_levels() {
+            std::size_t n = N, levels = 1;
+            while (n > 1) {
+                n = (n + B - 1) / B;
+                levels++;
+            }
+            return levels;
+        }
+
+        static constexpr std::size_t LEVELS = num_levels();
+
+        ///Node count of each level
+        static constexpr std::array<std::size_t, LEVELS> counts() {
+            std::array<std::size_t, LEVELS> out{};
+            std::size_t n = N;
+            for (std::size_t l = 0; l < LEVELS; l++) {
+                out[l] = n;
+                n = (n + B - 1) / B;
+            }
+            return out;
+        }
+
+        ///Position of the first node of each level
+        static constexpr std::array<std::size_t, LEVELS> starts() {
+            std::array<std::size_t, LEVELS> out{};
+            for (std::size_t l = 1; l < LEVELS; l++) {
+                out[l] = out[l - 1] + counts()[l - 1];
+            }
+            return out;
+        }
+
+        static constexpr std::size_t NUM_NODES = starts()[LEVELS - 1] + 1;
+
+        std::array<MBR<T>, NUM_NODES> boxes{};
+        std::array<uint32_t, N> ids{};
+
+        constexpr explicit StaticIndex(const std::array<MBR<T>, N> &items) {
+            auto extent = items[0];
+            for (std::size_t i = 1; i < N; i++) {
+                extent.expand_to_include(items[i]);
+            }
+            std::array<uint32_t, N> keys{};
+            for (std::size_t i = 0; i < N; i++) {
+                ids[i] = static_cast<uint32_t>(i);
+                keys[i] = hilbert(items[i], extent);
+            }
+            sort(keys);
+            for (std::size_t i = 0; i < N; i++) {
+                boxes[i] = items[ids[i]];
+            }
+            constexpr auto cnt = counts();
+            constexpr auto start = starts();
+            for (std::size_t l = 1; l < LEVELS; l++) {
+                for (std::size_t j = 0; j < cnt[l]; j++) {
+                    auto first = start[l - 1] + j * B;
+                    auto last = start[l - 1] + std::min((j + 1) * B, cnt[l - 1]);
+                    auto node = boxes[first];
+                    for (auto pos = first + 1; pos < last; pos++) {
+                        node.expand_to_include(boxes[pos]);
+                    }
+                    boxes[start[l] + j] = node;
+                }
+            }
+        }
+
+        [[nodiscard]] static constexpr std::size_t size() { return N; }
+
+        ///Bounds of all boxes
+        [[nodiscard]] constexpr MBR<T> bounds() const { return boxes[NUM_NODES - 1]; }
+
+        ///Calls visitor(box, id) for each box that intersects query until
+        ///the visitor returns false; returns false if stopped early
+        template<typename Visitor>
+        constexpr bool visit(const MBR<T> &query, Visitor &&visitor) const {
+            if (!query.intersects(bounds())) {
+                return true;
+            }
+            if constexpr (LEVELS == 1) {
+                return visitor(boxes[0], ids[0]);
+            }
+            else {
+                return visit_node<LEVELS - 1>(0, query, visitor);
+            }
+        }
+
+        ///Checks if any box intersects query
+        [[nodiscard]] constexpr bool any(const MBR<T> &query) const {
+            return !visit(query, [](const MBR<T> &, uint32_t) { return false; });
+        }
+
+        ///Checks if any box contains x, y
+        [[nodiscard]] constexpr bool any(T x, T y) const {
+            return any(MBR<T>{x, y, x, y, true});
+        }
+
+        ///Number of boxes that intersect query
+        [[nodiscard]] constexpr std::size_t count(const MBR<T> &query) const {
+            std::size_t n = 0;
+            visit(query, [&](const MBR<T> &, uint32_t) {
+                n++;
+                return true;
+            });
+            return n;
+        }
+
+        ///Id of the first box found that intersects query
+        [[nodiscard]] constexpr std::optional<uint32_t> first(const MBR<T> &query) const {
+            std::optional<uint32_t> hit;
+            visit(query, [&](const MBR<T> &, uint32_t id) {
+                hit = id;
+                return false;
+            });
+            return hit;
+        }
+
+    private:
+        ///Visits the children of node j of level L
+        template<std::size_t L, typename Visitor>
+        constexpr bool visit_node(std::size_t j, const MBR<T> &query, Visitor &visitor) const {
+            constexpr auto start = starts()[L - 1];
+            constexpr auto count = counts()[L - 1];
+            auto first = j * B;
+            auto last = std::min(first + B, count);
+            for (auto k = first; k < last; k++) {
+                auto &box = boxes[start + k];
+                if (!query.intersects(box)) {
+                    continue;
+                }
+                if constexpr (L == 1) {
+                    if (!visitor(box, ids[k])) {
+                        return false;
+                    }
+                }
+                else if (!visit_node<L - 1>(k, query, visitor)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        ///Heap sort of ids by keys, usable in constant expressions
+        constexpr void sort(std::array<uint32_t, N> &keys) {
+            auto swap = [&](std::size_t a, std::size_t b) {
+                auto k = keys[a];
+                keys[a] = keys[b];
+                keys[b] = k;
+                auto id = ids[a];
+                ids[a] = ids[b];
+                ids[b] = id;
+            };
+            auto sift = [&](std::size_t root, std::size_t end) {
+                while (2 * root + 1 < end) {
+                    auto child = 2 * root + 1;
+                    if (child + 1 < end && keys[child + 1] > keys[child]) {
+                        child++;
+                    }
+                    if (!(keys[child] > keys[root])) {
+                        return;
+                    }
+                    swap(root, child);
+                    root = child;
+                }
+            };
+            for (auto i = N / 2; i-- > 0;) {
+                sift(i, N);
+            }
+            for (auto end = N; end-- > 1;) {
+                swap(0, end);
+                sift(0, end);
+            }
+        }
+    };
+
+    template<typename T, std::size_t N>
+    StaticIndex(const std::array<MBR<T>, N> &) -> StaticIndex<T, N>;
+}
+#endif //MBR_STATIC_INDEX_H
@@ -0,0 +1,190 @@
+#include <limits>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+#include "bounds.h"
+#include "mmap.h"
+#include "pool.h"
+
+#ifndef MBR_STATS_H
+#define MBR_STATS_H
+namespace mbr {
+    ///Layout of a raw coordinate file of native doubles
+    enum class CoordLayout {
+        ///x0 y0 x1 y1 ...
+        interleaved,
+        ///x0 x1 ... then y0 y1 ...
+        columnar,
+    };
+
+    struct StatsOptions {
+        ///Bins of each axis histogram
+        std::size_t bins = 256;
+        ///Columns and rows of the occupancy grid
+        std::size_t grid_cols = 64;
+        std::size_t grid_rows = 64;
+        ///Range of the histograms and grid, points outside fall in the
+        ///edge bins; when unset it is the envelope, found by a first pass
+        std::optional<MBR<double>> extent;
+        ///Points per chunk handed to a worker
+        std::size_t grain = 1 << 20;
+    };
+
+    ///Envelope, per axis histograms and occupancy grid of a point set
+    struct CoordStats {
+        ///Points counted, those with a NaN or infinite coordinate excluded
+        uint64_t count = 0;
+        std::optional<MBR<double>> bounds;
+        ///Range the bins and cells divide
+        MBR<double> extent;
+        std::vector<uint64_t> x_hist;
+        std::vector<uint64_t> y_hist;
+        std::size_t grid_cols = 0;
+        std::size_t grid_rows = 0;
+        ///Points per cell, row major from miny
+        std::vector<uint64_t> grid;
+
+        ///Number of cells holding at least one point
+        [[nodiscard]] std::size_t occupied() const {
+            std::size_t n = 0;
+            for (auto c : grid) {
+                n += c != 0;
+            }
+            return n;
+        }
+    };
+
+    namespace stats {
+        ///Bin of v over [lo, lo + bins / scale), clamped to the edge bins
+        ///in double before the cast; NaN lands in bin 0
+        inline std::size_t bin(double v, double lo, double scale, std::size_t bins) {
+            auto b = (v - lo) * scale;
+            if (!(b > 0)) {
+                return 0;
+            }
+            return b >= static_cast<double>(bins) ? bins - 1 : static_cast<std::size_t>(b);
+        }
+
+        ///v if both v and the other coordinate w of its point are finite,
+        ///NaN otherwise, so a point with any infinite or NaN coordinate
+        ///is skipped whole
+        inline double finite(double v, double w) {
+            return v - v + (w - w) == 0 ? v : std::numeric_limits<double>::quiet_NaN();
+        }
+
+        inline double scale(double lo, double hi, std::size_t bins) {
+            return hi > lo ? static_cast<double>(bins) / (hi - lo) : 0.0;
+        }
+
+        ///Per worker counts, merged once all chunks are done
+        struct Part {
+            uint64_t count = 0;
+            std::vector<uint64_t> x_hist;
+            std::vector<uint64_t> y_hist;
+            std::vector<uint64_t> grid;
+        };
+    }
+
+    ///Statistics of n points at xs[i * stride], ys[i * stride] in one
+    ///pass over the data when options.extent is set, two otherwise.
+    ///Points with a non-finite coordinate are skipped, so they neither
+    ///widen the envelope nor collapse the bins.
+    inline CoordStats coord_stats(const double *xs, const double *ys, std::size_t stride, std::size_t n,
+                                  ThreadPool &pool, const StatsOptions &options = {}) {
+        auto x = [&](std::size_t i) { return stats::finite(xs[i * stride], ys[i * stride]); };
+        auto y = [&](std::size_t i) { return stats::finite(ys[i * stride], xs[i * stride]); };
+        CoordStats out;
+        auto bins = std::max<std::size_t>(options.bins, 1);
+        out.grid_cols = std::max<std::size_t>(options.grid_cols, 1);
+        out.grid_rows = std::max<std::size_t>(options.grid_rows, 1);
+        out.x_hist.assign(bins, 0);
+        out.y_hist.assign(bins, 0);
+        out.grid.assign(out.grid_cols * out.grid_rows, 0);
+
+        std::vector<bounds::Acc<double>> envelopes(pool.size());
+        if (options.extent) {
+            out.extent = *options.extent;
+        }
+        else {
+            pool.parallel_for(n, options.grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+                envelopes[worker].scan(begin, end, x, y);
+            });
+            for (std::size_t w = 1; w < envelopes.size(); w++) {
+                envelopes[0].merge(envelopes[w]);
+            }
+            out.bounds = envelopes[0].result();
+            if (!out.bounds) {
+                return out;
+            }
+            out.extent = *out.bounds;
+            envelopes.assign(pool.size(), bounds::Acc<double>{});
+        }
+
+        auto &e = out.extent;
+        auto sx = stats::scale(e.minx, e.maxx, bins), sy = stats::scale(e.miny, e.maxy, bins);
+        auto gx = stats::scale(e.minx, e.maxx, out.grid_cols), gy = stats::scale(e.miny, e.maxy, out.grid_rows);
+        std::vector<stats::Part> parts(pool.size());
+        pool.parallel_for(n, options.grain, [&](std::size_t begin, std::size_t end, std::size_t worker) {
+            auto &part = parts[worker];
+            if (part.x_hist.empty()) {
+                part.x_hist.assign(bins, 0);
+                part.y_hist.assign(bins, 0);
+                part.grid.assign(out.grid.size(), 0);
+            }
+            if (options.extent) {
+                envelopes[worker].scan(begin, end, x, y);
+            }
+            for (auto i = begin; i < end; i++) {
+                auto px = x(i), py = y(i);
+                if (px != px || py != py) {
+                    continue;
+                }
+                part.count++;
+                part.x_hist[stats::bin(px, e.minx, sx, bins)]++;
+                part.y_hist[stats::bin(py, e.miny, sy, bins)]++;
+                auto col = stats::bin(px, e.minx, gx, out.grid_cols);
+                auto row = stats::bin(py, e.miny, gy, out.grid_rows);
+                part.grid[row * out.grid_cols + col]++;
+            }
+        });
+        for (auto &part : parts) {
+            out.count += part.count;
+            for (std::size_t b = 0; b < part.x_hist.size(); b++) {
+                out.x_hist[b] += part.x_hist[b];
+                out.y_hist[b] += part.y_hist[b];
+            }
+            for (std::size_t c = 0; c < part.grid.size(); c++) {
+                out.grid[c] += part.grid[c];
+            }
+        }
+        if (options.extent) {
+            for (std::size_t w = 1; w < envelopes.size(); w++) {
+                envelopes[0].merge(envelopes[w]);
+            }
+            out.bounds = envelopes[0].result();
+        }
+        return out;
+    }
+
+    ///Statistics of a raw file of native doubles, memory mapped and read
+    ///sequentially by each worker over its own contiguous share
+    inline CoordStats read_coord_stats(const std::string &path, CoordLayout layout,
+                                       ThreadPool &pool, const StatsOptions &options = {}) {
+        MappedFile file(path, MADV_SEQUENTIAL);
+        if (file.size() % (2 * sizeof(double)) != 0) {
+            throw std::runtime_error("coordinate file size is not a multiple of 16 bytes : " + path);
+        }
+        auto n = file.size() / (2 * sizeof(double));
+        auto values = reinterpret_cast<const double *>(file.data());
+        if (n == 0) {
+            return coord_stats(values, values, 1, 0, pool, options);
+        }
+        if (layout == CoordLayout::interleaved) {
+            return coord_stats(values, values + 1, 2, n, pool, options);
+        }
+        return coord_stats(values, values + n, 1, n, pool, options);
+    }
+}
+#endif //MBR_STATS_H
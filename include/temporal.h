@@ -0,0 +1,165 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "index.h"
+
+#ifndef MBR_TEMPORAL_H
+#define MBR_TEMPORAL_H
+namespace mbr {
+    ///Box with a closed time interval [start, end]
+    template<typename T, typename Time = int64_t>
+    struct TimeBox {
+        MBR<T> box;
+        Time start;
+        Time end;
+
+        ///Checks if interval contains t
+        [[nodiscard]] constexpr bool active_at(Time t) const {
+            return start <= t && t <= end;
+        }
+
+        ///Checks if box intersects window and interval overlaps [t0, t1]
+        [[nodiscard]] constexpr bool intersects(const MBR<T> &window, Time t0, Time t1) const {
+            return start <= t1 && t0 <= end && box.intersects(window);
+        }
+
+        ///Expand include other box and interval
+        constexpr TimeBox &expand_to_include(const TimeBox &other) {
+            box.expand_to_include(other.box);
+            start = std::min(start, other.start);
+            end = std::max(end, other.end);
+            return *this;
+        }
+    };
+
+    namespace temporal {
+        ///Spreads the low 21 bits of v to every third bit
+        constexpr uint64_t spread3(uint64_t v) {
+            v &= 0x1FFFFF;
+            v = (v | v << 32) & 0x1F00000000FFFF;
+            v = (v | v << 16) & 0x1F0000FF0000FF;
+            v = (v | v << 8) & 0x100F00F00F00F00F;
+            v = (v | v << 4) & 0x10C30C30C30C30C3;
+            v = (v | v << 2) & 0x1249249249249249;
+            return v;
+        }
+
+        ///Cell of v scaled over [lo, hi] in a 2^21 grid
+        constexpr uint64_t cell(double v, double lo, double hi) {
+            constexpr double n = 0x1FFFFF;
+            return hi > lo ? static_cast<uint64_t>(n * ((v - lo) / (hi - lo))) : 0;
+        }
+    }
+
+    ///Static packed R-tree over boxes with time intervals. Nodes bound
+    ///space and time together, so window plus time range queries and
+    ///active at t queries prune on both instead of filtering spatial hits
+    ///by time. Leaves are ordered along a 3D Morton curve of box center
+    ///and interval midpoint. Item ids are positions in the input list.
+    template<typename T, typename Time = int64_t>
+    struct SpaceTimeIndex {
+        uint64_t num_items = 0;
+        uint64_t node_size = 16;
+        std::vector<TimeBox<T, Time>> nodes;
+        std::vector<uint64_t> indices;
+        std::vector<uint64_t> level_bounds;
+
+        SpaceTimeIndex() = default;
+
+        explicit SpaceTimeIndex(const std::vector<TimeBox<T, Time>> &items, uint64_t node_size = 16) :
+                SpaceTimeIndex(items.data(), items.size(), node_size) {}
+
+        SpaceTimeIndex(const TimeBox<T, Time> *items, std::size_t n, uint64_t node_size = 16) :
+                num_items(n), node_size(std::max<uint64_t>(node_size, 2)) {
+            if (n == 0) {
+                return;
+            }
+            packed::level_bounds(num_items, this->node_size, level_bounds);
+
+            auto extent = items[0];
+            for (std::size_t i = 1; i < n; i++) {
+                extent.expand_to_include(items[i]);
+            }
+            std::vector<uint64_t> keys(n);
+            for (std::size_t i = 0; i < n; i++) {
+                auto c = items[i].box.center();
+                auto t = (static_cast<double>(items[i].start) + static_cast<double>(items[i].end)) / 2;
+                auto x = temporal::cell(static_cast<double>(c.x), static_cast<double>(extent.box.minx),
+                                        static_cast<double>(extent.box.maxx));
+                auto y = temporal::cell(static_cast<double>(c.y), static_cast<double>(extent.box.miny),
+                                        static_cast<double>(extent.box.maxy));
+                auto z = temporal::cell(t, static_cast<double>(extent.start), static_cast<double>(extent.end));
+                keys[i] = temporal::spread3(x) | (temporal::spread3(y) << 1) | (temporal::spread3(z) << 2);
+            }
+            auto order = packed::order(keys);
+
+            nodes.resize(level_bounds.back());
+            indices.resize(level_bounds.back());
+            for (std::size_t i = 0; i < n; i++) {
+                nodes[i] = items[order[i]];
+                indices[i] = order[i];
+            }
+            packed::build(nodes.data(), indices.data(), level_bounds.data(), level_bounds.size(), this->node_size);
+        }
+
+        [[nodiscard]] bool empty() const { return num_items == 0; }
+
+        [[nodiscard]] uint64_t size() const { return num_items; }
+
+        ///Bounds and time span of all items
+        [[nodiscard]] TimeBox<T, Time> bounds() const {
+            return empty() ? TimeBox<T, Time>{} : nodes.back();
+        }
+
+        ///Calls visitor(item, id) for each item whose box intersects window
+        ///and whose interval overlaps [t0, t1], until the visitor returns
+        ///false; returns false if stopped early
+        template<typename Visitor>
+        bool visit(const MBR<T> &window, Time t0, Time t1, Visitor &&visitor) const {
+            return tree().visit([&](const TimeBox<T, Time> &node) { return node.intersects(window, t0, t1); },
+                                std::forward<Visitor>(visitor));
+        }
+
+        ///Ids of items whose box intersects window during [t0, t1]
+        std::vector<uint64_t> search(const MBR<T> &window, Time t0, Time t1) const {
+            std::vector<uint64_t> results;
+            visit(window, t0, t1, [&](const TimeBox<T, Time> &, uint64_t id) {
+                results.push_back(id);
+                return true;
+            });
+            return results;
+        }
+
+        ///Ids of items active at t anywhere
+        std::vector<uint64_t> active_at(Time t) const {
+            return search(bounds().box, t, t);
+        }
+
+        ///Ids of items active at t whose box intersects window
+        std::vector<uint64_t> active_at(Time t, const MBR<T> &window) const {
+            return search(window, t, t);
+        }
+
+        ///Number of items whose box intersects window during [t0, t1]
+        [[nodiscard]] std::size_t count(const MBR<T> &window, Time t0, Time t1) const {
+            std::size_t n = 0;
+            visit(window, t0, t1, [&](const TimeBox<T, Time> &, uint64_t) {
+                n++;
+                return true;
+            });
+            return n;
+        }
+
+        ///Checks if any item intersects window during [t0, t1]
+        [[nodiscard]] bool any(const MBR<T> &window, Time t0, Time t1) const {
+            return !visit(window, t0, t1, [](const TimeBox<T, Time> &, uint64_t) { return false; });
+        }
+
+    private:
+        [[nodiscard]] packed::Tree<TimeBox<T, Time>> tree() const {
+            return {nodes.data(), indices.data(), level_bounds.data(), num_items, level_bounds.size(), node_size};
+        }
+    };
+}
+#endif //MBR_TEMPORAL_H
@@ -0,0 +1,310 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <optional>
+
+#include "../mbr.h"
+
+#ifndef MBR_WKB_H
+#define MBR_WKB_H
+namespace mbr {
+    ///Size in bytes of a box encoded as a WKB polygon
+    constexpr std::size_t WKB_SIZE = 1 + 4 + 4 + 4 + 5 * 2 * 8;
+    ///Size in bytes of a box encoded as an EWKB polygon with srid
+    constexpr std::size_t EWKB_SIZE = WKB_SIZE + 4;
+
+    namespace wkb {
+        constexpr uint32_t POLYGON = 3;
+        constexpr uint32_t EWKB_Z = 0x80000000;
+        constexpr uint32_t EWKB_M = 0x40000000;
+        constexpr uint32_t EWKB_SRID = 0x20000000;
+        constexpr int MAX_DEPTH = 32;
+
+        constexpr bool little_endian() {
+            return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+        }
+
+        inline uint8_t *put(uint8_t *out, uint32_t v) {
+            std::memcpy(out, &v, sizeof(v));
+            return out + sizeof(v);
+        }
+
+        inline uint8_t *put(uint8_t *out, double v) {
+            std::memcpy(out, &v, sizeof(v));
+            return out + sizeof(v);
+        }
+
+        template<typename T>
+        uint8_t *polygon(const MBR<T> &box, uint32_t type, const uint32_t *srid, uint8_t *out) {
+            *out++ = little_endian() ? 1 : 0;
+            out = put(out, type);
+            if (srid) {
+                out = put(out, *srid);
+            }
+            out = put(out, uint32_t{1});
+            out = put(out, uint32_t{5});
+            auto minx = static_cast<double>(box.minx), miny = static_cast<double>(box.miny);
+            auto maxx = static_cast<double>(box.maxx), maxy = static_cast<double>(box.maxy);
+            const double xy[] = {minx, miny, minx, maxy, maxx, maxy, maxx, miny, minx, miny};
+            for (auto v : xy) {
+                out = put(out, v);
+            }
+            return out;
+        }
+
+        ///Walks the coordinates of a geometry, expanding an envelope
+        template<typename T>
+        struct Decoder {
+            const uint8_t *ptr;
+            const uint8_t *last;
+            bool swap = false;
+            bool empty = true;
+            MBR<T> box{};
+
+            bool u32(uint32_t &v) {
+                if (last - ptr < 4) {
+                    return false;
+                }
+                std::memcpy(&v, ptr, 4);
+                if (swap) {
+                    v = __builtin_bswap32(v);
+                }
+                ptr += 4;
+                return true;
+            }
+
+            [[nodiscard]] double f64(const uint8_t *p) const {
+                uint64_t u;
+                std::memcpy(&u, p, 8);
+                if (swap) {
+                    u = __builtin_bswap64(u);
+                }
+                double v;
+                std::memcpy(&v, &u, 8);
+                return v;
+            }
+
+            void include(double x, double y) {
+                if (empty) {
+                    box = MBR<T>{static_cast<T>(x), static_cast<T>(y),
+                                 static_cast<T>(x), static_cast<T>(y), true};
+                    empty = false;
+                }
+                else {
+                    box.expand_to_include(static_cast<T>(x), static_cast<T>(y));
+                }
+            }
+
+            ///Extends the envelope to the axis extremes of the circular
+            ///arc from a through b to c, which may bulge past its vertices
+            void arc(double ax, double ay, double bx, double by, double cx, double cy) {
+                double ox, oy;
+                if (ax == cx && ay == cy) {
+                    //full circle, b is diametrically opposite a
+                    ox = (ax + bx) / 2;
+                    oy = (ay + by) / 2;
+                }
+                else {
+                    auto d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+                    if (d == 0 || d != d) {
+                        return;
+                    }
+                    auto a2 = ax * ax + ay * ay, b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+                    ox = (a2 * (by - cy) + b2 * (cy - ay) + c2 * (ay - by)) / d;
+                    oy = (a2 * (cx - bx) + b2 * (ax - cx) + c2 * (bx - ax)) / d;
+                }
+                auto r = std::hypot(ax - ox, ay - oy);
+                if (r != r) {
+                    return;
+                }
+                auto from = std::atan2(ay - oy, ax - ox), to = std::atan2(cy - oy, cx - ox);
+                //sweep counter clockwise from a to c
+                if ((bx - ax) * (cy - by) - (by - ay) * (cx - bx) < 0) {
+                    std::swap(from, to);
+                }
+                auto turn = [](double t) { return t < 0 ? t + 2 * M_PI : t; };
+                auto sweep = ax == cx && ay == cy ? 2 * M_PI : turn(to - from);
+                const double extremes[][3] = {{0, 1, 0}, {M_PI / 2, 0, 1}, {M_PI, -1, 0}, {-M_PI / 2, 0, -1}};
+                for (auto &e : extremes) {
+                    if (turn(std::remainder(e[0] - from, 2 * M_PI)) <= sweep) {
+                        include(ox + r * e[1], oy + r * e[2]);
+                    }
+                }
+            }
+
+            bool points(uint32_t n, std::size_t dims) {
+                auto stride = dims * 8;
+                if (static_cast<std::size_t>(last - ptr) / stride < n) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < n; i++, ptr += stride) {
+                    auto x = f64(ptr), y = f64(ptr + 8);
+                    if (!std::isnan(x) && !std::isnan(y)) {
+                        include(x, y);
+                    }
+                }
+                return true;
+            }
+
+            ///Circular string of n points : arcs through points 2i, 2i + 1, 2i + 2
+            bool arcs(uint32_t n, std::size_t dims) {
+                auto first = ptr;
+                if (!points(n, dims)) {
+                    return false;
+                }
+                auto stride = dims * 8;
+                for (uint32_t i = 0; i + 2 < n; i += 2) {
+                    auto p = first + i * stride;
+                    arc(f64(p), f64(p + 8), f64(p + stride), f64(p + stride + 8),
+                        f64(p + 2 * stride), f64(p + 2 * stride + 8));
+                }
+                return true;
+            }
+
+            bool geometry(int depth = 0) {
+                if (depth > MAX_DEPTH || ptr == last || *ptr > 1) {
+                    return false;
+                }
+                swap = (*ptr++ == 1) != little_endian();
+                uint32_t type;
+                if (!u32(type)) {
+                    return false;
+                }
+                bool z = type & EWKB_Z, m = type & EWKB_M;
+                if (type & EWKB_SRID) {
+                    uint32_t srid;
+                    if (!u32(srid)) {
+                        return false;
+                    }
+                }
+                type &= 0x0FFFFFFF;
+                auto iso = type / 1000;
+                type %= 1000;
+                z = z || iso == 1 || iso == 3;
+                m = m || iso == 2 || iso == 3;
+                std::size_t dims = 2 + z + m;
+
+                uint32_t n;
+                switch (type) {
+                    case 1: //point
+                        return points(1, dims);
+                    case 2: //linestring
+                        return u32(n) && points(n, dims);
+                    case 3: //polygon
+                    case 17: //triangle
+                        if (!u32(n)) {
+                            return false;
+                        }
+                        for (uint32_t i = 0; i < n; i++) {
+                            uint32_t np;
+                            if (!u32(np) || !points(np, dims)) {
+                                return false;
+                            }
+                        }
+                        return true;
+                    case 8: //circular string
+                        return u32(n) && arcs(n, dims);
+                    case 4: //multipoint
+                    case 5: //multilinestring
+                    case 6: //multipolygon
+                    case 7: //geometry collection
+                    case 9: //compound curve, of line and circular strings
+                    case 10: //curve polygon, of curve rings
+                    case 11: //multicurve
+                    case 12: //multisurface
+                    case 15: //polyhedral surface
+                    case 16: //tin
+                        if (!u32(n)) {
+                            return false;
+                        }
+                        for (uint32_t i = 0; i < n; i++) {
+                            if (!geometry(depth + 1)) {
+                                return false;
+                            }
+                        }
+                        return true;
+                    default:
+                        //13 curve and 14 surface are abstract, never encoded
+                        return false;
+                }
+            }
+        };
+    }
+
+    ///Writes box as a WKB polygon of WKB_SIZE bytes, returns one past the end
+    template<typename T>
+    uint8_t *write_wkb(const MBR<T> &box, uint8_t *out) {
+        return wkb::polygon(box, wkb::POLYGON, nullptr, out);
+    }
+
+    ///Writes box as an EWKB polygon with srid of EWKB_SIZE bytes, returns one past the end
+    template<typename T>
+    uint8_t *write_ewkb(const MBR<T> &box, uint32_t srid, uint8_t *out) {
+        return wkb::polygon(box, wkb::POLYGON | wkb::EWKB_SRID, &srid, out);
+    }
+
+    ///Appends boxes as back to back WKB polygons
+    template<typename T>
+    void write_wkb(const MBR<T> *boxes, std::size_t n, std::vector<uint8_t> &out) {
+        auto offset = out.size();
+        out.resize(offset + n * WKB_SIZE);
+        auto ptr = out.data() + offset;
+        for (std::size_t i = 0; i < n; i++) {
+            ptr = write_wkb(boxes[i], ptr);
+        }
+    }
+
+    ///Appends boxes as back to back EWKB polygons with srid
+    template<typename T>
+    void write_ewkb(const MBR<T> *boxes, std::size_t n, uint32_t srid, std::vector<uint8_t> &out) {
+        auto offset = out.size();
+        out.resize(offset + n * EWKB_SIZE);
+        auto ptr = out.data() + offset;
+        for (std::size_t i = 0; i < n; i++) {
+            ptr = write_ewkb(boxes[i], srid, ptr);
+        }
+    }
+
+    ///Envelope of the WKB, ISO WKB or EWKB geometry at the start of
+    ///[first, last), read directly from the coordinates without building
+    ///the geometry; circular arcs count their bulge, not just vertices. Returns one past the geometry or nullptr if malformed;
+    ///box is nullopt for an empty geometry.
+    template<typename T>
+    const uint8_t *read_wkb_envelope(const uint8_t *first, const uint8_t *last,
+                                     std::optional<MBR<T>> &box) {
+        wkb::Decoder<T> dec{first, last};
+        if (!dec.geometry()) {
+            return nullptr;
+        }
+        box = dec.empty ? std::nullopt : std::optional<MBR<T>>{dec.box};
+        return dec.ptr;
+    }
+
+    ///Envelope of a WKB geometry, nullopt if empty or malformed
+    template<typename T>
+    std::optional<MBR<T>> wkb_envelope(const uint8_t *data, std::size_t size) {
+        std::optional<MBR<T>> box;
+        if (!read_wkb_envelope(data, data + size, box)) {
+            return std::nullopt;
+        }
+        return box;
+    }
+
+    ///Envelopes of back to back WKB geometries in [first, last),
+    ///false if the stream is malformed
+    template<typename T>
+    bool read_wkb_envelopes(const uint8_t *first, const uint8_t *last,
+                            std::vector<std::optional<MBR<T>>> &out) {
+        while (first != last) {
+            std::optional<MBR<T>> box;
+            first = read_wkb_envelope(first, last, box);
+            if (!first) {
+                return false;
+            }
+            out.push_back(box);
+        }
+        return true;
+    }
+}
+#endif //MBR_WKB_H
@@ -0,0 +1,247 @@
+#include <string>
+#include <vector>
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <stdexcept>
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+#include "../mbr.h"
+#include "mmap.h"
+
+#ifndef MBR_WKT_H
+#define MBR_WKT_H
+namespace mbr {
+    ///Appends wkt of boxes to out, each followed by sep
+    template<typename T>
+    void write_wkt(const MBR<T> *boxes, std::size_t n, std::string &out, char sep = '\n') {
+        for (std::size_t i = 0; i < n; i++) {
+            boxes[i].wkt(out);
+            out.push_back(sep);
+        }
+    }
+
+    template<typename T>
+    void write_wkt(const std::vector<MBR<T>> &boxes, std::string &out, char sep = '\n') {
+        write_wkt(boxes.data(), boxes.size(), out, sep);
+    }
+
+    namespace wkt {
+        inline void write_all(int fd, const char *data, std::size_t size) {
+            while (size > 0) {
+                auto n = ::write(fd, data, size);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "write");
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+        }
+
+        ///Cursor over a single line of text
+        struct Reader {
+            const char *ptr;
+            const char *last;
+
+            void ws() {
+                while (ptr != last && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')) {
+                    ptr++;
+                }
+            }
+
+            bool lit(char c) {
+                ws();
+                if (ptr != last && *ptr == c) {
+                    ptr++;
+                    return true;
+                }
+                return false;
+            }
+
+            ///Case insensitive keyword of ascii letters
+            bool keyword(const char *kw) {
+                ws();
+                auto p = ptr;
+                for (; *kw != '\0'; kw++, p++) {
+                    if (p == last || (*p | 0x20) != (*kw | 0x20)) {
+                        return false;
+                    }
+                }
+                ptr = p;
+                return true;
+            }
+
+            template<typename T>
+            bool num(T &v) {
+                ws();
+                auto res = std::from_chars(ptr, last, v);
+                if (res.ec != std::errc{}) {
+                    return false;
+                }
+                ptr = res.ptr;
+                return true;
+            }
+
+            ///Envelope of the rings of a polygon after the POLYGON keyword
+            template<typename T>
+            bool polygon(MBR<T> &out) {
+                if (!keyword("ZM") && !keyword("Z")) {
+                    keyword("M");
+                }
+                bool first = true;
+                if (!lit('(')) {
+                    return false;
+                }
+                do {
+                    if (!lit('(')) {
+                        return false;
+                    }
+                    do {
+                        T x, y, z;
+                        if (!num(x) || !num(y)) {
+                            return false;
+                        }
+                        while (num(z)) {}
+                        if (first) {
+                            out = MBR<T>{x, y, x, y, true};
+                            first = false;
+                        }
+                        else {
+                            out.expand_to_include(x, y);
+                        }
+                    } while (lit(','));
+                    if (!lit(')')) {
+                        return false;
+                    }
+                } while (lit(','));
+                return lit(')');
+            }
+
+            ///Four comma separated values
+            template<typename T>
+            bool bounds(MBR<T> &out) {
+                T a, b, c, d;
+                if (!num(a) || !lit(',') || !num(b) || !lit(',') ||
+                    !num(c) || !lit(',') || !num(d)) {
+                    return false;
+                }
+                out = MBR<T>{a, b, c, d};
+                return true;
+            }
+        };
+    }
+
+    ///Streams wkt of boxes to file descriptor fd, each followed by sep,
+    ///through a single reused buffer of buffer_size bytes
+    template<typename T>
+    void write_wkt(const MBR<T> *boxes, std::size_t n, int fd,
+                   char sep = '\n', std::size_t buffer_size = 1u << 20) {
+        constexpr auto max_len = wkt_max_len<T>();
+        std::vector<char> buf(std::max(buffer_size, max_len + 1));
+        auto first = buf.data();
+        auto last = first + buf.size();
+        auto ptr = first;
+        for (std::size_t i = 0; i < n; i++) {
+            if (static_cast<std::size_t>(last - ptr) <= max_len) {
+                wkt::write_all(fd, first, ptr - first);
+                ptr = first;
+            }
+            auto res = boxes[i].wkt(ptr, last);
+            if (res.ec != std::errc{}) {
+                throw std::system_error(std::make_error_code(res.ec), "wkt");
+            }
+            ptr = res.ptr;
+            *ptr++ = sep;
+        }
+        wkt::write_all(fd, first, ptr - first);
+    }
+
+    template<typename T>
+    void write_wkt(const std::vector<MBR<T>> &boxes, int fd,
+                   char sep = '\n', std::size_t buffer_size = 1u << 20) {
+        write_wkt(boxes.data(), boxes.size(), fd, sep, buffer_size);
+    }
+
+    ///Parses a box from the start of [first, last) given as
+    ///`POLYGON ((...))` (its envelope), `BBOX(minx,miny,maxx,maxy)`
+    ///or `minx,miny,maxx,maxy`, returns one past the parsed text
+    template<typename T>
+    std::from_chars_result parse_mbr(const char *first, const char *last, MBR<T> &out) {
+        wkt::Reader rd{first, last};
+        bool ok;
+        if (rd.keyword("POLYGON")) {
+            ok = rd.polygon(out);
+        }
+        else if (rd.keyword("BBOX")) {
+            ok = rd.lit('(') && rd.bounds(out) && rd.lit(')');
+        }
+        else {
+            ok = rd.bounds(out);
+        }
+        if (!ok) {
+            return {first, std::errc::invalid_argument};
+        }
+        return {rd.ptr, std::errc{}};
+    }
+
+    ///Parses text holding a single box
+    template<typename T>
+    std::optional<MBR<T>> parse_mbr(std::string_view s) {
+        MBR<T> out;
+        auto last = s.data() + s.size();
+        auto res = parse_mbr(s.data(), last, out);
+        if (res.ec != std::errc{}) {
+            return std::nullopt;
+        }
+        wkt::Reader rd{res.ptr, last};
+        rd.ws();
+        if (rd.ptr != last) {
+            return std::nullopt;
+        }
+        return out;
+    }
+
+    ///Parses one box per line, skipping blank lines; stops at the first
+    ///line that does not parse and returns its start with an error
+    template<typename T>
+    std::from_chars_result parse_mbrs(const char *first, const char *last, std::vector<MBR<T>> &out) {
+        while (first != last) {
+            wkt::Reader rd{first, last};
+            rd.ws();
+            if (rd.ptr != last && *rd.ptr != '\n') {
+                MBR<T> box;
+                auto res = parse_mbr(rd.ptr, last, box);
+                if (res.ec != std::errc{}) {
+                    return {first, res.ec};
+                }
+                rd.ptr = res.ptr;
+                rd.ws();
+                if (rd.ptr != last && *rd.ptr != '\n') {
+                    return {first, std::errc::invalid_argument};
+                }
+                out.push_back(box);
+            }
+            first = rd.ptr == last ? last : rd.ptr + 1;
+        }
+        return {last, std::errc{}};
+    }
+
+    ///Reads one box per line from a memory mapped text file
+    template<typename T>
+    std::vector<MBR<T>> read_mbrs(const std::string &path) {
+        MappedFile file(path);
+        std::vector<MBR<T>> out;
+        auto res = parse_mbrs(file.begin(), file.end(), out);
+        if (res.ec != std::errc{}) {
+            throw std::runtime_error("invalid box at byte " +
+                                     std::to_string(res.ptr - file.begin()) + " of " + path);
+        }
+        return out;
+    }
+}
+#endif //MBR_WKT_H
@@ -2,7 +2,28 @@
 
 #include <iostream>
 #include <cmath>
+#include <random>
+#include <thread>
 #include "mbr.h"
+#include "include/index.h"
+#include "include/shm.h"
+#include "include/wkt.h"
+#include "include/wkb.h"
+#include "include/arrow.h"
+#include "include/shp.h"
+#include "include/fgb.h"
+#include "include/snapshot.h"
+#include "include/batch.h"
+#include "include/cursor.h"
+#include "include/static_index.h"
+#include "include/temporal.h"
+#include "include/moving.h"
+#include "include/bounds.h"
+#include "include/stats.h"
+#include "include/clip.h"
+#include "include/ray.h"
+#include "include/chains.h"
+#include "include/obb.h"
 #include "include/catch.h"
 
 using namespace mbr;
@@ -364,4 +385,1533 @@ TEST_CASE("mbr 2", "[mbr 2]") {
     SECTION("wkt string") {
         REQUIRE(m1.wkt() == "POLYGON ((0 0, 0 2, 2 2, 2 0, 0 0))");
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("wkt writer", "[wkt]") {
+    MBR<double> m{-0.1, 1.0 / 3.0, 2.5, 1e6};
+    REQUIRE(m.wkt() == "POLYGON ((-0.1 0.3333333333333333, -0.1 1000000, "
+                       "2.5 1000000, 2.5 0.3333333333333333, -0.1 0.3333333333333333))");
+    REQUIRE(MBR<int>(3, -4, 1, 2).wkt() == "POLYGON ((1 -4, 1 2, 3 2, 3 -4, 1 -4))");
+    REQUIRE(MBR<float>(0.1f, 0, 1, 1).wkt() == "POLYGON ((0.1 0, 0.1 1, 1 1, 1 0, 0.1 0))");
+    //shortest round trip, not rounded to a fixed number of digits
+    REQUIRE(MBR<double>(0.1 + 0.2, 0, 1, 1).wkt() ==
+            "POLYGON ((0.30000000000000004 0, 0.30000000000000004 1, 1 1, 1 0, 0.30000000000000004 0))");
+    std::string appended = "x";
+    MBR<double>(-1e308, -1e308, 1e308, 1e308).wkt(appended);
+    REQUIRE(appended.size() > 3000);
+    REQUIRE(appended.compare(0, 11, "xPOLYGON ((") == 0);
+    REQUIRE(appended.compare(appended.size() - 2, 2, "))") == 0);
+    //fixed notation of the extremes of each type stays within wkt_max_len
+    auto widest = [](auto lo, auto hi) {
+        using T = decltype(lo);
+        auto text = MBR<T>(lo, hi, hi, lo).wkt();
+        return text.size() <= wkt_max_len<T>() && text.compare(text.size() - 2, 2, "))") == 0;
+    };
+    REQUIRE(widest(std::numeric_limits<double>::lowest(), std::numeric_limits<double>::denorm_min()));
+    REQUIRE(widest(-std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max()));
+    REQUIRE(widest(std::numeric_limits<float>::lowest(), -std::numeric_limits<float>::denorm_min()));
+    REQUIRE(widest(std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()));
+    REQUIRE(widest(-1e4000L, 1e-4000L));
+    REQUIRE(widest(std::numeric_limits<long double>::lowest(), std::numeric_limits<long double>::denorm_min()));
+
+    char buf[64];
+    auto res = m.wkt(buf, buf + sizeof(buf));
+    REQUIRE(res.ec == std::errc::value_too_large);
+    MBR<double> u{0, 0, 1, 1};
+    res = u.wkt(buf, buf + sizeof(buf));
+    REQUIRE(res.ec == std::errc{});
+    REQUIRE(std::string(buf, res.ptr) == "POLYGON ((0 0, 0 1, 1 1, 1 0, 0 0))");
+
+    std::vector<MBR<double>> boxes{u, m, u};
+    std::string out;
+    write_wkt(boxes, out);
+    REQUIRE(out == u.wkt() + "\n" + m.wkt() + "\n" + u.wkt() + "\n");
+
+    auto f = std::tmpfile();
+    write_wkt(boxes, fileno(f), '\n', 16);
+    std::string back(out.size() + 1, '\0');
+    std::rewind(f);
+    back.resize(std::fread(back.data(), 1, back.size(), f));
+    std::fclose(f);
+    REQUIRE(back == out);
+
+    std::vector<MBR<long double>> huge{{-1e4000L, 0, 1e4000L, 1}, {0, 0, 1, 1}};
+    f = std::tmpfile();
+    write_wkt(huge, fileno(f), '\n', 16);
+    back.assign(30000, '\0');
+    std::rewind(f);
+    back.resize(std::fread(back.data(), 1, back.size(), f));
+    std::fclose(f);
+    REQUIRE(back == huge[0].wkt() + "\n" + huge[1].wkt() + "\n");
+}
+std::vector<MBR<double>> random_boxes(std::size_t n, unsigned seed = 7) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> xy(0, 100);
+    std::uniform_real_distribution<double> wh(0, 3);
+    std::vector<MBR<double>> boxes;
+    boxes.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        auto x = xy(gen), y = xy(gen);
+        boxes.emplace_back(x, y, x + wh(gen), y + wh(gen));
+    }
+    return boxes;
+}
+
+std::vector<uint64_t> brute_search(const std::vector<MBR<double>> &boxes, const MBR<double> &q) {
+    std::vector<uint64_t> ids;
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+        if (q.intersects(boxes[i])) {
+            ids.push_back(i);
+        }
+    }
+    return ids;
+}
+
+TEST_CASE("packed index", "[index]") {
+    auto boxes = random_boxes(2000);
+    Index<double> index(boxes, 8);
+    REQUIRE(index.size() == 2000);
+
+    auto all = boxes[0];
+    for (auto &b : boxes) {
+        all.expand_to_include(b);
+    }
+    REQUIRE(index.bounds().equals(all));
+
+    for (auto &q : random_boxes(50, 11)) {
+        auto w = q;
+        w.expand_by_delta(5, 5);
+        auto ids = index.search(w);
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids == brute_search(boxes, w));
+    }
+
+    Index<double> empty(std::vector<MBR<double>>{});
+    REQUIRE(empty.search({0, 0, 100, 100}).empty());
+
+    Index<double> one(std::vector<MBR<double>>{{1, 1, 2, 2}});
+    REQUIRE(one.search({0, 0, 1, 1}) == std::vector<uint64_t>{0});
+}
+
+TEST_CASE("index visitor", "[index]") {
+    auto boxes = random_boxes(2000);
+    Index<double> index(boxes, 4);
+    MBR<double> q{30, 30, 50, 50};
+    auto expect = brute_search(boxes, q);
+
+    std::vector<uint64_t> seen;
+    REQUIRE(index.visit(q, [&](const MBR<double> &box, uint64_t id) {
+        seen.push_back(id);
+        return box.equals(boxes[id]);
+    }));
+    std::sort(seen.begin(), seen.end());
+    REQUIRE(seen == expect);
+
+    std::size_t calls = 0;
+    REQUIRE_FALSE(index.visit(q, [&](const MBR<double> &, uint64_t) { return ++calls < 3; }));
+    REQUIRE(calls == 3);
+
+    REQUIRE(index.any(q));
+    REQUIRE_FALSE(index.any({200, 200, 300, 300}));
+    REQUIRE(index.count(q) == expect.size());
+    auto hit = index.first(q);
+    REQUIRE(std::binary_search(expect.begin(), expect.end(), hit.value()));
+    REQUIRE_FALSE(index.first({-5, -5, -4, -4}).has_value());
+
+    Index<double> wide(boxes, 300);
+    REQUIRE(wide.count(q) == expect.size());
+    REQUIRE(Index<double>().count(q) == 0);
+}
+
+TEST_CASE("shared memory index", "[shm]") {
+    auto name = "/mbr_cpp_test_" + std::to_string(getpid());
+    auto boxes = random_boxes(500);
+    ShmPublisher<double> publisher(name);
+    REQUIRE(publisher.publish(Index<double>(boxes)) == 1);
+
+    ShmReader<double> reader(name);
+    REQUIRE(reader.generation() == 1);
+    MBR<double> q{10, 10, 30, 30};
+    auto ids = reader.search(q);
+    std::sort(ids.begin(), ids.end());
+    REQUIRE(ids == brute_search(boxes, q));
+    REQUIRE_FALSE(reader.refresh());
+
+    auto next = random_boxes(300, 3);
+    REQUIRE(publisher.publish(Index<double>(next)) == 2);
+    REQUIRE(reader.generation() == 1);
+    REQUIRE(reader.refresh());
+    REQUIRE(reader.generation() == 2);
+    ids = reader.search(q);
+    std::sort(ids.begin(), ids.end());
+    REQUIRE(ids == brute_search(next, q));
+
+    //segment left behind by a publisher that died mid publish
+    auto stale = shm::data_name(name, 3);
+    auto fd = shm_open(stale.c_str(), O_CREAT | O_RDWR, 0644);
+    REQUIRE(fd >= 0);
+    close(fd);
+    REQUIRE(publisher.publish(Index<double>(boxes)) == 3);
+    REQUIRE(reader.refresh());
+    ids = reader.search(q);
+    std::sort(ids.begin(), ids.end());
+    REQUIRE(ids == brute_search(boxes, q));
+
+    publisher.unlink();
+}
+
+TEST_CASE("wkt parser", "[wkt]") {
+    MBR<double> m{-0.1, 1.0 / 3.0, 2.5, 1e6};
+    REQUIRE(parse_mbr<double>(m.wkt()).value().equals(m));
+    REQUIRE((parse_mbr<double>(" polygon z ((1 2 9, 5 -1 9, 3 7 9, 1 2 9), (2 2 0, 3 3 0, 2 2 0)) ")
+                    .value().as_array() == std::array<double, 4>{{1, -1, 5, 7}}));
+    std::array<double, 4> r{1.5, 2, 3, 4};
+    REQUIRE(parse_mbr<double>("BBOX(3, 4, 1.5, 2)").value().as_array() == r);
+    std::array<int, 4> ri{1, 2, 3, 4};
+    REQUIRE(parse_mbr<int>("1,2,3,4").value().as_array() == ri);
+    REQUIRE_FALSE(parse_mbr<double>("POLYGON ((1 2, 3))").has_value());
+    REQUIRE_FALSE(parse_mbr<double>("BBOX(1,2,3)").has_value());
+    REQUIRE_FALSE(parse_mbr<double>("1,2,3,4 x").has_value());
+
+    std::string text = "0,0,1,1\r\n\n  BBOX(2,2,3,3)\n" + m.wkt() + "\n";
+    std::vector<MBR<double>> out;
+    auto res = parse_mbrs(text.data(), text.data() + text.size(), out);
+    REQUIRE(res.ec == std::errc{});
+    REQUIRE(out.size() == 3);
+    r = {2, 2, 3, 3};
+    REQUIRE(out[1].as_array() == r);
+    REQUIRE(out[2].equals(m));
+
+    text += "1,2\n5,5,6,6\n";
+    out.clear();
+    res = parse_mbrs(text.data(), text.data() + text.size(), out);
+    REQUIRE(res.ec == std::errc::invalid_argument);
+    REQUIRE(out.size() == 3);
+    REQUIRE(std::string(res.ptr, 4) == "1,2\n");
+
+    char path[] = "/tmp/mbr_cpp_wktXXXXXX";
+    auto fd = mkstemp(path);
+    auto boxes = random_boxes(100);
+    write_wkt(boxes, fd);
+    close(fd);
+    auto back = read_mbrs<double>(path);
+    unlink(path);
+    REQUIRE(back.size() == boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+        REQUIRE(back[i].equals(boxes[i]));
+        REQUIRE(back[i].as_array() == boxes[i].as_array());
+    }
+}
+
+TEST_CASE("wkb", "[wkb]") {
+    MBR<double> m{-1.5, 2, 3, 4.25};
+    uint8_t buf[EWKB_SIZE];
+    REQUIRE(write_wkb(m, buf) == buf + WKB_SIZE);
+    REQUIRE(buf[0] == 1);
+    REQUIRE(wkb_envelope<double>(buf, WKB_SIZE).value().as_array() == m.as_array());
+    REQUIRE_FALSE(wkb_envelope<double>(buf, WKB_SIZE - 1).has_value());
+
+    REQUIRE(write_ewkb(m, 4326, buf) == buf + EWKB_SIZE);
+    REQUIRE(wkb_envelope<double>(buf, EWKB_SIZE).value().as_array() == m.as_array());
+
+    // big endian ISO LINESTRING Z (1 2 3, -4 5 6) inside a MULTILINESTRING
+    std::vector<uint8_t> be{0, 0, 0, 0, 5, 0, 0, 0, 1,
+                            0, 0, 0, 0x03, 0xEA, 0, 0, 0, 2};
+    for (double v : {1.0, 2.0, 3.0, -4.0, 5.0, 6.0}) {
+        uint64_t u;
+        std::memcpy(&u, &v, 8);
+        for (int i = 7; i >= 0; i--) {
+            be.push_back(static_cast<uint8_t>(u >> (i * 8)));
+        }
+    }
+    std::array<double, 4> r{-4, 2, 1, 5};
+    REQUIRE(wkb_envelope<double>(be.data(), be.size()).value().as_array() == r);
+
+    // POINT EMPTY
+    uint8_t pt[21] = {1, 1, 0, 0, 0};
+    double nan = std::nan("");
+    std::memcpy(pt + 5, &nan, 8);
+    std::memcpy(pt + 13, &nan, 8);
+    std::optional<MBR<double>> box{m};
+    REQUIRE(read_wkb_envelope(pt, pt + 21, box) == pt + 21);
+    REQUIRE_FALSE(box.has_value());
+
+    auto boxes = random_boxes(20);
+    std::vector<uint8_t> stream;
+    write_wkb(boxes.data(), boxes.size(), stream);
+    REQUIRE(stream.size() == boxes.size() * WKB_SIZE);
+    std::vector<std::optional<MBR<double>>> out;
+    REQUIRE(read_wkb_envelopes(stream.data(), stream.data() + stream.size(), out));
+    REQUIRE(out.size() == boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+        REQUIRE(out[i].value().as_array() == boxes[i].as_array());
+    }
+    stream.back() = 0;
+    stream.push_back(7);
+    REQUIRE_FALSE(read_wkb_envelopes(stream.data(), stream.data() + stream.size(), out));
+}
+
+TEST_CASE("wkb curves", "[wkb]") {
+    //little endian header, then count and xy pairs
+    auto head = [](std::vector<uint8_t> &w, uint32_t type) {
+        w.push_back(1);
+        w.insert(w.end(), reinterpret_cast<uint8_t *>(&type), reinterpret_cast<uint8_t *>(&type) + 4);
+    };
+    auto count = [](std::vector<uint8_t> &w, uint32_t n) {
+        w.insert(w.end(), reinterpret_cast<uint8_t *>(&n), reinterpret_cast<uint8_t *>(&n) + 4);
+    };
+    auto curve = [&](std::vector<uint8_t> &w, uint32_t type, std::vector<double> xy, std::size_t dims = 2) {
+        head(w, type);
+        count(w, static_cast<uint32_t>(xy.size() / dims));
+        for (auto &v : xy) {
+            w.insert(w.end(), reinterpret_cast<uint8_t *>(&v), reinterpret_cast<uint8_t *>(&v) + 8);
+        }
+    };
+    auto env = [](const std::vector<uint8_t> &w) {
+        return wkb_envelope<double>(w.data(), w.size()).value().as_array();
+    };
+    auto s = std::sqrt(0.5);
+
+    //arc from 45 to 315 degrees through 180 bulges past its vertices
+    std::vector<uint8_t> w;
+    curve(w, 8, {s, s, -1, 0, s, -s});
+    auto e = env(w);
+    REQUIRE(std::abs(e[0] + 1) < 1e-12);
+    REQUIRE(std::abs(e[1] + 1) < 1e-12);
+    REQUIRE(std::abs(e[2] - s) < 1e-12);
+    REQUIRE(std::abs(e[3] - 1) < 1e-12);
+    //same arc walked clockwise
+    w.clear();
+    curve(w, 8, {s, -s, -1, 0, s, s});
+    REQUIRE(env(w) == e);
+    //short arc from 45 through 90 to 135 degrees keeps to its side
+    w.clear();
+    curve(w, 8, {s, s, 0, 1, -s, s});
+    e = env(w);
+    REQUIRE(std::abs(e[1] - s) < 1e-12);
+    REQUIRE(std::abs(e[3] - 1) < 1e-12);
+    //full circle
+    w.clear();
+    curve(w, 8, {3, 0, 1, 0, 3, 0});
+    REQUIRE((env(w) == std::array<double, 4>{1, -1, 3, 1}));
+
+    //compound curve : line then half circle over the top
+    w.clear();
+    head(w, 9);
+    count(w, 2);
+    curve(w, 2, {-5, 0, 0, 0});
+    curve(w, 8, {0, 0, 1, 1, 2, 0});
+    REQUIRE((env(w) == std::array<double, 4>{-5, 0, 2, 1}));
+
+    //multisurface of a curve polygon with a compound ring
+    std::vector<uint8_t> ms;
+    head(ms, 12);
+    count(ms, 1);
+    head(ms, 10);
+    count(ms, 1);
+    ms.insert(ms.end(), w.begin(), w.end());
+    REQUIRE((env(ms) == std::array<double, 4>{-5, 0, 2, 1}));
+
+    //multicurve, ISO Z circular string
+    std::vector<uint8_t> mc;
+    head(mc, 11);
+    count(mc, 1);
+    curve(mc, 1008, {0, 0, 9, 1, 1, 9, 2, 0, 9}, 3);
+    REQUIRE((env(mc) == std::array<double, 4>{0, 0, 2, 1}));
+
+    //abstract curve and surface are never encoded
+    w.clear();
+    curve(w, 13, {0, 0, 1, 1});
+    REQUIRE_FALSE(wkb_envelope<double>(w.data(), w.size()).has_value());
+}
+
+TEST_CASE("arrow c data interface", "[arrow]") {
+    auto boxes = random_boxes(100);
+    MBR<double> q{20, 20, 40, 40};
+    auto expect = brute_search(boxes, q);
+
+    ArrowSchema schema{};
+    ArrowArray array{};
+    export_boxes(boxes, &schema, &array);
+    REQUIRE(std::string(schema.format) == "+w:4");
+    REQUIRE(array.length == 100);
+
+    auto col = import_boxes(&schema, &array).value();
+    REQUIRE(col.size() == 100);
+    REQUIRE(col.boxes() == array.children[0]->buffers[1]);
+    REQUIRE(col[7].equals(boxes[7]));
+    std::vector<uint64_t> ids;
+    col.search(q, ids);
+    REQUIRE(ids == expect);
+    REQUIRE(col.bounds().value().equals(Index<double>(boxes).bounds()));
+
+    array.offset = 10;
+    array.length = 5;
+    col = import_boxes(&schema, &array).value();
+    REQUIRE(col[0].equals(boxes[10]));
+    REQUIRE(col.size() == 5);
+
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(array.release == nullptr);
+    REQUIRE(schema.release == nullptr);
+    REQUIRE_FALSE(import_boxes(&schema, &array).has_value());
+
+    std::vector<double> minx, miny, maxx, maxy;
+    for (auto &b : boxes) {
+        minx.push_back(b.minx);
+        miny.push_back(b.miny);
+        maxx.push_back(b.maxx);
+        maxy.push_back(b.maxy);
+    }
+    export_box_columns(minx, miny, maxx, maxy, &schema, &array);
+    REQUIRE(std::string(schema.format) == "+s");
+    REQUIRE(std::string(schema.children[2]->name) == "maxx");
+    col = import_boxes(&schema, &array).value();
+    REQUIRE(col.boxes() == nullptr);
+    REQUIRE(col[42].equals(boxes[42]));
+    ids.clear();
+    col.search(q, ids);
+    REQUIRE(ids == expect);
+
+    uint8_t validity[13];
+    std::memset(validity, 0xFF, sizeof(validity));
+    validity[0] = 0xFE;
+    array.null_count = 1;
+    array.buffers[0] = validity;
+    col = import_boxes(&schema, &array).value();
+    REQUIRE_FALSE(col.is_valid(0));
+    REQUIRE(col.is_valid(1));
+
+    //a child moved out outlives its parent and is released on its own
+    ArrowArray child = *array.children[1];
+    array.children[1]->release = nullptr;
+    ArrowSchema child_schema = *schema.children[1];
+    schema.children[1]->release = nullptr;
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(std::string(child_schema.name) == "miny");
+    REQUIRE(child.length == 100);
+    REQUIRE(static_cast<const double *>(child.buffers[1])[42] == boxes[42].miny);
+    child.release(&child);
+    child_schema.release(&child_schema);
+    REQUIRE(child.release == nullptr);
+
+    maxy.pop_back();
+    REQUIRE_THROWS_AS(export_box_columns(minx, miny, maxx, maxy, &schema, &array), const std::invalid_argument &);
+}
+
+void put_be32(std::string &s, uint32_t v) {
+    for (int i = 3; i >= 0; i--) {
+        s.push_back(static_cast<char>(v >> (i * 8)));
+    }
+}
+
+template<typename V>
+void put_le(std::string &s, V v) {
+    char b[sizeof(V)];
+    std::memcpy(b, &v, sizeof(V));
+    s.append(b, sizeof(V));
+}
+
+void write_file(const std::string &path, const std::string &data) {
+    auto f = std::fopen(path.c_str(), "wb");
+    std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+}
+
+TEST_CASE("shapefile record boxes", "[shp]") {
+    // polygon, null and point records
+    std::vector<std::string> contents(3);
+    put_le<int32_t>(contents[0], 5);
+    for (double v : {1.0, 2.0, 5.0, 6.0}) {
+        put_le(contents[0], v);
+    }
+    put_le<int32_t>(contents[0], 1);
+    put_le<int32_t>(contents[0], 4);
+    put_le<int32_t>(contents[0], 0);
+    for (double v : {1.0, 2.0, 1.0, 6.0, 5.0, 6.0, 1.0, 2.0}) {
+        put_le(contents[0], v);
+    }
+    put_le<int32_t>(contents[1], 0);
+    put_le<int32_t>(contents[2], 1);
+    put_le(contents[2], 7.5);
+    put_le(contents[2], -1.0);
+
+    auto header = [](std::size_t size) {
+        std::string h;
+        put_be32(h, 9994);
+        h.append(20, '\0');
+        put_be32(h, static_cast<uint32_t>(size / 2));
+        put_le<int32_t>(h, 1000);
+        put_le<int32_t>(h, 5);
+        for (double v : {1.0, -1.0, 7.5, 6.0, 0.0, 0.0, 0.0, 0.0}) {
+            put_le(h, v);
+        }
+        return h;
+    };
+    std::string records, index;
+    for (std::size_t i = 0; i < contents.size(); i++) {
+        put_be32(index, static_cast<uint32_t>((100 + records.size()) / 2));
+        put_be32(index, static_cast<uint32_t>(contents[i].size() / 2));
+        put_be32(records, static_cast<uint32_t>(i + 1));
+        put_be32(records, static_cast<uint32_t>(contents[i].size() / 2));
+        records += contents[i];
+    }
+    auto base = "/tmp/mbr_cpp_shp_" + std::to_string(getpid());
+    write_file(base + ".shp", header(100 + records.size()) + records);
+
+    ShpFile walk(base + ".shp");
+    REQUIRE_FALSE(walk.has_shx());
+    REQUIRE(walk.shape_type == 5);
+    std::array<double, 4> r{1, -1, 7.5, 6};
+    REQUIRE(walk.bounds.as_array() == r);
+
+    write_file(base + ".shx", header(100 + index.size()) + index);
+    ShpFile indexed(base + ".shp");
+    REQUIRE(indexed.has_shx());
+
+    for (auto *file : {&walk, &indexed}) {
+        auto out = file->boxes();
+        REQUIRE((out.records == std::vector<uint64_t>{0, 2}));
+        r = {1, 2, 5, 6};
+        REQUIRE(out.boxes[0].as_array() == r);
+        REQUIRE(out.boxes[1].is_point());
+        auto ids = out.index().search({7, -2, 8, 0});
+        REQUIRE(ids.size() == 1);
+        REQUIRE(out.records[ids[0]] == 2);
+    }
+
+    write_file(base + ".shp", header(100) + records.substr(0, 40));
+    ShpFile truncated(base + ".shp", "");
+    REQUIRE_THROWS(truncated.boxes());
+    unlink((base + ".shp").c_str());
+    unlink((base + ".shx").c_str());
+}
+
+TEST_CASE("flatgeobuf packed index", "[fgb]") {
+    auto boxes = random_boxes(5000);
+    auto bytes = fgb_index(boxes.data(), boxes.size());
+    REQUIRE(bytes.size() == fgb::index_size(boxes.size(), 16));
+
+    fgb::NodeItem root{};
+    std::memcpy(&root, bytes.data(), sizeof(root));
+    auto all = Index<double>(boxes).bounds();
+    REQUIRE(MBR<double>(root.minx, root.miny, root.maxx, root.maxy).equals(all));
+    REQUIRE(root.offset == 1);
+
+    auto path = "/tmp/mbr_cpp_fgb_" + std::to_string(getpid());
+    write_fgb_index(path, boxes.data(), boxes.size());
+    FgbIndexReader reader(path, boxes.size());
+
+    MBR<double> q{40, 40, 45, 45};
+    auto hits = reader.search(q);
+    std::vector<uint64_t> ids;
+    for (auto &h : hits) {
+        ids.push_back(h.offset);
+        REQUIRE(h.index < boxes.size());
+    }
+    std::sort(ids.begin(), ids.end());
+    REQUIRE(ids == brute_search(boxes, q));
+    REQUIRE(reader.bytes_read < bytes.size() / 4);
+
+    std::vector<uint64_t> offsets(boxes.size());
+    for (std::size_t i = 0; i < offsets.size(); i++) {
+        offsets[i] = 1000 + i * 10;
+    }
+    std::string prefix(64, 'h');
+    auto embedded = fgb_index(boxes.data(), boxes.size(), offsets.data());
+    write_file(path, prefix + std::string(embedded.begin(), embedded.end()));
+    FgbIndexReader in_file(path, boxes.size(), 16, prefix.size());
+    auto all_hits = in_file.search(all);
+    REQUIRE(all_hits.size() == boxes.size());
+    REQUIRE(std::all_of(all_hits.begin(), all_hits.end(), [](const FgbItem &h) {
+        return h.offset >= 1000 && (h.offset - 1000) % 10 == 0;
+    }));
+
+    //child offsets outside the next level down come from a corrupt file
+    auto leaf_start = fgb::level_bounds(boxes.size(), 16).front().first;
+    for (uint64_t child : {uint64_t{1} << 40, leaf_start}) {
+        auto corrupt = bytes;
+        std::memcpy(corrupt.data() + offsetof(fgb::NodeItem, offset), &child, sizeof(child));
+        write_file(path, std::string(corrupt.begin(), corrupt.end()));
+        FgbIndexReader broken(path, boxes.size());
+        REQUIRE_THROWS_AS(broken.search(all), const std::runtime_error &);
+    }
+
+    //node sizes from a corrupt header would hang or divide by zero
+    for (uint16_t bad : {0, 1}) {
+        REQUIRE_THROWS_AS(fgb_index(boxes.data(), boxes.size(), nullptr, bad), const std::invalid_argument &);
+        REQUIRE_THROWS_AS(FgbIndexReader(path, boxes.size(), bad, prefix.size()), const std::invalid_argument &);
+        REQUIRE_THROWS_AS(fgb::index_size(boxes.size(), bad), const std::invalid_argument &);
+    }
+    unlink(path.c_str());
+}
+
+TEST_CASE("snapshot index", "[snapshot]") {
+    auto first = random_boxes(1000, 1);
+    auto second = random_boxes(1000, 2);
+    SnapshotIndex<double> index(Index<double>(first), 8);
+    MBR<double> q{10, 10, 60, 60};
+    auto expect_first = brute_search(first, q);
+    auto expect_second = brute_search(second, q);
+
+    {
+        auto reader = index.reader();
+        auto ids = reader.read([&](const Index<double> &snap) {
+            index.publish(Index<double>(second));
+            REQUIRE(index.pending() == 1); //pinned reader keeps the old snapshot
+            return snap.search(q);
+        });
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids == expect_first);
+        index.reclaim();
+        REQUIRE(index.pending() == 0);
+
+        ids = reader.search(q);
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids == expect_second);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            auto reader = index.reader();
+            while (!done.load()) {
+                auto ids = reader.search(q);
+                std::sort(ids.begin(), ids.end());
+                if (ids != expect_first && ids != expect_second) {
+                    bad++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 50; i++) {
+        index.publish(Index<double>(i % 2 ? second : first));
+    }
+    done = true;
+    for (auto &t : readers) {
+        t.join();
+    }
+    index.reclaim();
+    REQUIRE(bad == 0);
+    REQUIRE(index.pending() == 0);
+}
+
+TEST_CASE("knn", "[index]") {
+    auto boxes = random_boxes(3000);
+    Index<double> index(boxes);
+    for (auto &q : random_boxes(20, 5)) {
+        auto ids = index.knn(q, 10);
+        REQUIRE(ids.size() == 10);
+        std::vector<double> dists;
+        for (auto &b : boxes) {
+            dists.push_back(q.distance_square(b));
+        }
+        auto sorted = dists;
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t i = 0; i < ids.size(); i++) {
+            REQUIRE(dists[ids[i]] == sorted[i]);
+        }
+    }
+    MBR<double> far{1000, 1000, 1001, 1001};
+    REQUIRE(index.knn(far, 5, 10.0).empty());
+    REQUIRE(index.knn(far, 5000).size() == 3000);
+}
+
+TEST_CASE("batch queries", "[batch]") {
+    auto boxes = random_boxes(5000);
+    Index<double> index(boxes);
+    auto windows = random_boxes(1000, 9);
+    for (auto &w : windows) {
+        w.expand_by_delta(2, 2);
+    }
+    ThreadPool pool(4);
+    auto csr = query_many(index, windows, pool, 16);
+    REQUIRE(csr.size() == windows.size());
+    bool same = true;
+    for (std::size_t i = 0; i < windows.size(); i++) {
+        same = same && std::vector<uint64_t>(csr.begin(i), csr.end(i)) == index.search(windows[i]);
+    }
+    REQUIRE(same);
+
+    auto near = knn_many(index, windows, 3, pool);
+    REQUIRE(near.indices.size() == 3 * windows.size());
+    for (std::size_t i = 0; i < windows.size(); i++) {
+        same = same && std::vector<uint64_t>(near.begin(i), near.end(i)) == index.knn(windows[i], 3);
+    }
+    REQUIRE(same);
+    REQUIRE(query_many(index, std::vector<MBR<double>>{}, pool).size() == 0);
+
+    for (std::size_t group : {1, 8, 32}) {
+        auto inter = query_many_interleaved(index, windows, pool, group, 100);
+        REQUIRE(inter.offsets == csr.offsets);
+        for (std::size_t i = 0; i < windows.size(); i++) {
+            std::vector<uint64_t> a(inter.begin(i), inter.end(i)), b(csr.begin(i), csr.end(i));
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            same = same && a == b;
+        }
+        REQUIRE(same);
+    }
+    REQUIRE(query_many_interleaved(Index<double>(), windows, pool).indices.empty());
+
+    //windows centered outside the index extent clamp onto its edges
+    std::vector<MBR<double>> outside{{-500, -500, -400, -400}, {1e300, 5, 1e301, 6}, {-1, 10, 1, 30},
+                                     {20, 1e30, 30, 2e30}, {-1e308, -1e308, 1e308, 1e308}};
+    auto clamped = query_many_interleaved(index, outside, pool, 8, 1);
+    for (std::size_t i = 0; i < outside.size(); i++) {
+        std::vector<uint64_t> got(clamped.begin(i), clamped.end(i));
+        std::sort(got.begin(), got.end());
+        same = same && got == brute_search(boxes, outside[i]);
+    }
+    REQUIRE(same);
+    REQUIRE(hilbert(MBR<double>{-500, -500, -400, -400}, index.bounds()) == hilbert(0, 0));
+
+    //a throw on the calling thread or a worker surfaces once the loop drains
+    for (std::size_t thrower : {0, 1, 3}) {
+        std::atomic<std::size_t> chunks{0};
+        REQUIRE_THROWS_AS(pool.parallel_for(100000, 10, [&](std::size_t, std::size_t, std::size_t worker) {
+            chunks++;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            if (worker == thrower) {
+                throw std::runtime_error("chunk failed");
+            }
+        }), const std::runtime_error &);
+        REQUIRE(chunks < 10000);
+    }
+    std::atomic<std::size_t> covered{0};
+    pool.parallel_for(1000, 10, [&](std::size_t begin, std::size_t end, std::size_t) { covered += end - begin; });
+    REQUIRE(covered == 1000);
+}
+
+TEST_CASE("lazy cursors", "[cursor]") {
+    auto boxes = random_boxes(3000);
+    Index<double> index(boxes);
+    MBR<double> q{20, 20, 35, 35};
+
+    std::vector<uint64_t> ids;
+    for (auto id : lazy_search(index, q)) {
+        ids.push_back(id);
+    }
+    REQUIRE(ids == index.search(q));
+
+    auto cursor = lazy_search(index, q);
+    uint64_t id;
+    REQUIRE(cursor.next(id));
+    REQUIRE(id == ids[0]);
+    REQUIRE(lazy_search(index, MBR<double>{500, 500, 600, 600}).begin() ==
+            lazy_search(index, MBR<double>{500, 500, 600, 600}).end());
+
+    auto knn = index.knn(q, 50);
+    std::size_t i = 0;
+    double last = 0;
+    bool ordered = true;
+    for (auto &item : lazy_nearest(index, q)) {
+        ordered = ordered && item.distance >= last &&
+                  item.distance == q.distance(boxes[item.id]) &&
+                  q.distance_square(boxes[item.id]) == q.distance_square(boxes[knn[i]]);
+        last = item.distance;
+        if (++i == knn.size()) {
+            break;
+        }
+    }
+    REQUIRE(ordered);
+    REQUIRE(i == 50);
+
+    std::size_t within = 0;
+    for (auto &item : lazy_nearest(index, q, 2.0)) {
+        within += item.distance <= 2.0;
+    }
+    REQUIRE(within == static_cast<std::size_t>(std::count_if(boxes.begin(), boxes.end(), [&](const MBR<double> &b) {
+        return q.distance(b) <= 2.0;
+    })));
+}
+
+struct CountingResource : std::pmr::memory_resource {
+    std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+    std::size_t allocations = 0;
+
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        allocations++;
+        return upstream->allocate(bytes, align);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override {
+        upstream->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_CASE("index memory resources", "[index]") {
+    auto boxes = random_boxes(2000);
+    Index<double> heap(boxes);
+    MBR<double> q{10, 10, 30, 30};
+
+    CountingResource counting;
+    std::pmr::monotonic_buffer_resource arena(1 << 16, &counting);
+    Index<double> in_arena(boxes.data(), boxes.size(), 16, &arena);
+    REQUIRE(counting.allocations > 0);
+    REQUIRE(in_arena.boxes.get_allocator().resource() == &arena);
+    REQUIRE(in_arena.search(q) == heap.search(q));
+
+    auto moved = std::move(in_arena);
+    REQUIRE(moved.knn(q, 20) == heap.knn(q, 20));
+
+    std::pmr::unsynchronized_pool_resource pool(&counting);
+    auto before = counting.allocations;
+    NearestCursor<double> cursor(heap.view(), q, 50.0, &pool);
+    SearchCursor<double> window(heap.view(), q, &pool);
+    std::size_t n = 0;
+    for (auto &item : cursor) {
+        n += item.distance <= 50.0;
+    }
+    for (auto id : window) {
+        n += id < boxes.size();
+    }
+    REQUIRE(n > 0);
+    REQUIRE(counting.allocations > before);
+}
+
+TEST_CASE("constexpr mbr", "[constexpr]") {
+    constexpr MBR<double> a{2, 2, 0, 0};
+    constexpr MBR<double> b{1, 1, 3, 4};
+    constexpr auto u = a + b;
+    static_assert(a.minx == 0 && a.maxx == 2);
+    static_assert(u.equals(MBR<double>{0, 0, 3, 4}));
+    static_assert(a.intersects(b) && !a.contains(b) && u.contains(b));
+    static_assert(a.contains(1.0, 1.0) && a.completely_contains(1.0, 1.0));
+    static_assert(a.translate(1, 1) == MBR<double>(1, 1, 3, 3));
+    static_assert(a.intersection(b).value() == MBR<double>(1, 1, 2, 2));
+    static_assert(!a.intersection(MBR<double>{5, 5, 6, 6}).has_value());
+    static_assert(a.center() == Pt<double>{1, 1});
+    static_assert(MBR<double>(Pt<double>{3, 1}, Pt<double>{1, 3}).area() == 4);
+    static_assert(a.distance_square(MBR<double>{5, 6, 7, 8}) == 25);
+    static_assert(MBR<int>(std::array<int, 4>{4, 3, 2, 1}).as_array()[0] == 2);
+
+    constexpr auto grown = [] {
+        MBR<double> m{0, 0, 1, 1};
+        m.expand_to_include(-1, 5);
+        m.expand_to_include(MBR<double>{2, 2, 3, 3});
+        m.expand_by_delta(1, 1);
+        return m;
+    }();
+    static_assert(grown == MBR<double>(-2, -1, 4, 6));
+
+    constexpr std::array<MBR<double>, 2> zones{{{0, 0, 10, 10}, {20, 20, 30, 30}}};
+    static_assert(zones[1].intersects(MBR<double>{25, 25, 26, 26}));
+
+    double nan = std::nan("");
+    MBR<double> n{nan, 0, 1, 1};
+    REQUIRE(n.minx == 1);
+    REQUIRE(n.maxx == 1);
+    REQUIRE(feq(0.1 + 0.2, 0.3));
+    REQUIRE_FALSE(feq(nan, nan));
+}
+
+constexpr std::array<MBR<double>, 256> geofence_zones() {
+    std::array<MBR<double>, 256> zones{};
+    uint32_t s = 12345;
+    auto next = [&] {
+        s = s * 1103515245u + 12345u;
+        return static_cast<double>((s >> 8) % 10000) / 100.0;
+    };
+    for (auto &z : zones) {
+        auto x = next(), y = next();
+        z = MBR<double>{x, y, x + next() / 40, y + next() / 40};
+    }
+    return zones;
+}
+
+TEST_CASE("static geofence index", "[static index]") {
+    static constexpr auto zones = geofence_zones();
+    static constexpr StaticIndex<double, 256> fence{zones};
+    static_assert(fence.size() == 256);
+    static_assert(fence.any(zones[42].center().x, zones[42].center().y));
+    static_assert(!fence.any(MBR<double>{-10, -10, -5, -5}));
+    static_assert(fence.count(fence.bounds()) == 256);
+
+    static constexpr StaticIndex one{std::array<MBR<double>, 1>{{{0, 0, 1, 1}}}};
+    static_assert(one.any(0.5, 0.5) && !one.any(2.0, 2.0));
+    static_assert(one.first(MBR<double>{1, 1, 2, 2}).value() == 0);
+
+    std::vector<MBR<double>> boxes(zones.begin(), zones.end());
+    for (auto &q : random_boxes(200, 11)) {
+        std::vector<uint64_t> ids;
+        fence.visit(q, [&](const MBR<double> &box, uint32_t id) {
+            REQUIRE(box == zones[id]);
+            ids.push_back(id);
+            return true;
+        });
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids == brute_search(boxes, q));
+        REQUIRE(fence.any(q) == !ids.empty());
+    }
+}
+
+TEST_CASE("n-dimensional mbr", "[mbr nd]") {
+    static_assert(sizeof(MBR<double, 3>) == 64 && alignof(MBR<double, 3>) == 32);
+    static_assert(sizeof(MBR<float, 4>) == 32);
+    static_assert(MBR<double, 5>::LANES == 8 && MBR<double, 7>::LANES == 8 && MBR<double, 9>::LANES == 16);
+    static_assert(sizeof(MBR<double, 5>) == 128 && alignof(MBR<double, 9>) == 64);
+    static_assert(std::is_same<MBR<double>, MBR<double, 2>>::value);
+
+    constexpr MBR3d<double> a{2, 2, 2, 0, 0, 0};
+    constexpr MBR3d<double> b{Pt3d<double>{1, 1, 1}, Pt3d<double>{3, 4, 5}};
+    static_assert(a.lo[0] == 0 && a.hi[2] == 2 && a.lo[3] == 0 && a.hi[3] == 0);
+    static_assert(a.intersects(b) && !a.contains(b) && (a + b).contains(b));
+    static_assert((a | b) == MBR3d<double>(0, 0, 0, 3, 4, 5));
+    static_assert((a & b).value() == MBR3d<double>(1, 1, 1, 2, 2, 2));
+    static_assert(a.contains(Pt3d<double>{1, 1, 2}) && !a.contains(Pt3d<double>{1, 1, 3}));
+    static_assert(a.volume() == 8 && (a + b).volume() == 60);
+    static_assert(a.distance_square(MBR3d<double>{4, 5, 6, 5, 6, 7}) == 4 + 9 + 16);
+    static_assert(a.as_2d() == MBR<double>(0, 0, 2, 2));
+    static_assert(MBR3d<double>(MBR<double>{0, 0, 2, 2}, 2, 0) == a);
+
+    //same answers as a 2D box plus a separate z interval
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> c(0, 10);
+    for (int i = 0; i < 200; i++) {
+        MBR3d<double> p{c(gen), c(gen), c(gen), c(gen), c(gen), c(gen)};
+        MBR3d<double> q{c(gen), c(gen), c(gen), c(gen), c(gen), c(gen)};
+        bool z = p.lo[2] <= q.hi[2] && q.lo[2] <= p.hi[2];
+        REQUIRE(p.intersects(q) == (p.as_2d().intersects(q.as_2d()) && z));
+        auto dz = std::max({0.0, q.lo[2] - p.hi[2], p.lo[2] - q.hi[2]});
+        REQUIRE(p.distance_square(q) == Approx(p.as_2d().distance_square(q.as_2d()) + dz * dz));
+    }
+
+    MBR<int, 4> u{{0, 0, 0, 0}, {1, 1, 1, 1}};
+    u.expand_to_include({-1, 2, 0, 5});
+    REQUIRE((u == MBR<int, 4>{{-1, 0, 0, 0}, {1, 2, 1, 5}}));
+    REQUIRE(u.center()[3] == 2);
+    REQUIRE((MBR<int, 4>({3, 3, 3, 3}).is_point()));
+
+    MBR<double, 5> v{{0, 0, 0, 0, 0}, {1, 1, 1, 1, 1}};
+    v.expand_to_include({2, -1, 0, 0, 3});
+    REQUIRE(v.volume() == 12);
+    REQUIRE((v.intersects(MBR<double, 5>{{2, 1, 1, 1, 3}, {4, 4, 4, 4, 4}})));
+    REQUIRE_FALSE((v.intersects(MBR<double, 5>{{0, 0, 0, 0, 3.5}, {1, 1, 1, 1, 4}})));
+    REQUIRE((v.lo[5] == 0 && v.hi[7] == 0));
+}
+
+TEST_CASE("space time index", "[temporal]") {
+    static_assert(temporal::spread3(0x1FFFFF) == 0x1249249249249249);
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int64_t> start(0, 10000);
+    std::uniform_int_distribution<int64_t> span(0, 50);
+    auto boxes = random_boxes(3000, 9);
+    std::vector<TimeBox<double>> items;
+    for (auto &b : boxes) {
+        auto t = start(gen);
+        items.push_back({b, t, t + span(gen)});
+    }
+    SpaceTimeIndex<double> index(items, 8);
+    REQUIRE(index.size() == 3000);
+    REQUIRE(index.bounds().box == Index<double>(boxes).bounds());
+
+    auto brute = [&](const MBR<double> &w, int64_t t0, int64_t t1) {
+        std::vector<uint64_t> ids;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            if (items[i].intersects(w, t0, t1)) {
+                ids.push_back(i);
+            }
+        }
+        return ids;
+    };
+    auto queries = random_boxes(100, 13);
+    for (std::size_t i = 0; i < queries.size(); i++) {
+        auto q = queries[i].expand_by_delta(5, 5);
+        auto t0 = start(gen), t1 = t0 + span(gen) * 4;
+        auto ids = index.search(q, t0, t1);
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(ids == brute(q, t0, t1));
+        REQUIRE(index.count(q, t0, t1) == ids.size());
+        REQUIRE(index.any(q, t0, t1) == !ids.empty());
+
+        auto active = index.active_at(t0);
+        std::sort(active.begin(), active.end());
+        REQUIRE(active == brute(index.bounds().box, t0, t0));
+        for (auto id : active) {
+            REQUIRE(items[id].active_at(t0));
+        }
+    }
+    REQUIRE(index.active_at(-1).empty());
+    REQUIRE(SpaceTimeIndex<double>{}.search(queries[0], 0, 10).empty());
+}
+
+TEST_CASE("moving index", "[moving]") {
+    constexpr MovingBox<double> car{{0, 0, 2, 2}, {1, -1, 3, 1}, 10};
+    static_assert(car.at(10) == MBR<double>(0, 0, 2, 2));
+    static_assert(car.at(12) == MBR<double>(2, -2, 8, 4));
+    static_assert(car.rebase(12).at(14) == car.at(14));
+    static_assert(car.intersects(MBR<double>{7, 0, 8, 1}, 10, 12));
+    static_assert(!car.intersects(MBR<double>{7, 0, 8, 1}, 10, 11));
+    static_assert(!car.intersects(MBR<double>{-5, 5, -4, 6}, 10, 100));
+
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<double> v(-1, 1);
+    std::uniform_real_distribution<double> t(0, 5);
+    std::vector<MovingBox<double>> items;
+    for (auto &b : random_boxes(2000, 17)) {
+        auto vx = v(gen), vy = v(gen);
+        items.push_back({b, {vx, vy, vx + v(gen) / 4, vy + v(gen) / 4}, t(gen)});
+    }
+    MovingIndex<double> index(items, 8);
+    REQUIRE(index.time == Approx(0).margin(0.01));
+
+    auto brute = [&](const MBR<double> &w, double t1, double t2) {
+        std::vector<uint64_t> ids;
+        for (std::size_t i = 0; i < items.size(); i++) {
+            if (items[i].intersects(w, std::max(t1, index.time), t2)) {
+                ids.push_back(i);
+            }
+        }
+        return ids;
+    };
+    auto check = [&] {
+        for (auto &q : random_boxes(50, 23)) {
+            auto t1 = t(gen) * 4, t2 = t1 + t(gen);
+            auto ids = index.search(q, t1, t2);
+            std::sort(ids.begin(), ids.end());
+            REQUIRE(ids == brute(q, t1, t2));
+            for (auto id : index.search(q, t2)) {
+                REQUIRE(items[id].at(t2).intersects(q));
+            }
+        }
+    };
+    check();
+
+    //sampled positions agree with the exact interval test
+    for (std::size_t i = 0; i < 200; i++) {
+        auto q = MBR<double>{50, 50, 55, 55};
+        bool seen = false;
+        for (int s = 0; s <= 200 && !seen; s++) {
+            seen = items[i].at(10 + s * 0.05).intersects(q);
+        }
+        if (seen) {
+            REQUIRE(items[i].intersects(q, 10, 20));
+        }
+    }
+
+    for (std::size_t i = 0; i < items.size(); i += 7) {
+        auto now = items[i].time + 5;
+        items[i] = MovingBox<double>{items[i].at(now), {-2, -2, 2, 2}, now};
+        index.update(i, items[i]);
+        REQUIRE(index.item(i).time == now);
+    }
+    check();
+}
+
+TEST_CASE("bounds of points", "[bounds]") {
+    std::mt19937 gen(31);
+    std::uniform_real_distribution<double> c(-1000, 1000);
+    std::vector<Pt<double>> pts(100003);
+    std::vector<double> xs, ys;
+    for (auto &p : pts) {
+        p = {c(gen), c(gen)};
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    MBR<double> expected(pts[0]);
+    for (auto &p : pts) {
+        expected.expand_to_include(p.x, p.y);
+    }
+    pts[17].x = std::nan("");
+    xs[17] = std::nan("");
+
+    ThreadPool pool(4);
+    REQUIRE(bounds_of(pts).value() == expected);
+    REQUIRE(bounds_of(xs.data(), ys.data(), xs.size()).value() == expected);
+    REQUIRE(bounds_of(pts, pool, 1000).value() == expected);
+    REQUIRE(bounds_of(xs.data(), ys.data(), xs.size(), pool, 1000).value() == expected);
+    REQUIRE(bounds_of(pts.data(), 5, pool).value() == bounds_of(pts.data(), 5).value());
+
+    REQUIRE_FALSE(bounds_of(std::vector<Pt<double>>{}).has_value());
+    REQUIRE_FALSE(bounds_of(std::vector<Pt<double>>{}, pool).has_value());
+    std::vector<Pt<int>> ints{{3, -2}, {-7, 4}, {1, 9}};
+    REQUIRE(bounds_of(ints).value() == MBR<int>(-7, -2, 3, 9));
+
+    MBR<double> m{0, 0, 1, 1};
+    m.expand_to_include(std::nan(""), 2);
+    REQUIRE(m == MBR<double>(0, 0, 1, 2));
+}
+
+TEST_CASE("coordinate file statistics", "[stats]") {
+    std::mt19937 gen(41);
+    std::normal_distribution<double> c(0, 10);
+    std::size_t n = 50000;
+    std::vector<double> interleaved, xs, ys;
+    for (std::size_t i = 0; i < n; i++) {
+        auto x = c(gen), y = c(gen) + 100;
+        interleaved.push_back(x);
+        interleaved.push_back(y);
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+    auto path = "/tmp/mbr_cpp_coords_" + std::to_string(getpid());
+    auto columnar = xs;
+    columnar.insert(columnar.end(), ys.begin(), ys.end());
+    auto bytes = [](const std::vector<double> &v) {
+        return std::string(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(double));
+    };
+
+    ThreadPool pool(4);
+    StatsOptions options;
+    options.bins = 32;
+    options.grid_cols = 8;
+    options.grid_rows = 4;
+    options.grain = 4096;
+
+    write_file(path, bytes(interleaved));
+    auto a = read_coord_stats(path, CoordLayout::interleaved, pool, options);
+    write_file(path, bytes(columnar));
+    auto b = read_coord_stats(path, CoordLayout::columnar, pool, options);
+
+    auto env = bounds_of(xs.data(), ys.data(), n).value();
+    for (auto *s : {&a, &b}) {
+        REQUIRE(s->count == n);
+        REQUIRE(s->bounds.value() == env);
+        REQUIRE(s->extent == env);
+        REQUIRE(std::accumulate(s->x_hist.begin(), s->x_hist.end(), uint64_t{0}) == n);
+        REQUIRE(std::accumulate(s->grid.begin(), s->grid.end(), uint64_t{0}) == n);
+        REQUIRE(s->grid.size() == 32);
+        REQUIRE(s->x_hist == a.x_hist);
+        REQUIRE(s->y_hist == a.y_hist);
+        REQUIRE(s->grid == a.grid);
+    }
+    //normal data peaks in the middle bins
+    REQUIRE(a.x_hist[16] + a.x_hist[15] > a.x_hist[0] + a.x_hist[31]);
+    REQUIRE(a.occupied() <= 32);
+
+    //single pass over a given extent, outliers land in the edge bins
+    options.extent = MBR<double>{-5, 95, 5, 105};
+    auto fixed = read_coord_stats(path, CoordLayout::columnar, pool, options);
+    REQUIRE(fixed.bounds.value() == env);
+    uint64_t below = 0;
+    for (auto x : xs) {
+        below += x < -5 + 10.0 / 32;
+    }
+    REQUIRE(fixed.x_hist[0] == below);
+
+    //points with a non-finite coordinate are skipped whole, even when the
+    //other coordinate lies outside the envelope; huge finite ones clamp to the edge bins
+    auto inf = std::numeric_limits<double>::infinity();
+    auto odd = interleaved;
+    odd.insert(odd.end(), {inf, 1e6, -1e6, -inf, std::nan(""), -1e6, 1e300, -1e300});
+    write_file(path, bytes(odd));
+    auto skipped = read_coord_stats(path, CoordLayout::interleaved, pool, options);
+    REQUIRE(skipped.count == n + 1);
+    REQUIRE(skipped.x_hist[31] == fixed.x_hist[31] + 1);
+    REQUIRE(skipped.y_hist[0] == fixed.y_hist[0] + 1);
+    options.extent.reset();
+    skipped = read_coord_stats(path, CoordLayout::interleaved, pool, options);
+    REQUIRE(skipped.count == n + 1);
+    REQUIRE(skipped.bounds.value() == (env + MBR<double>(1e300, -1e300, 1e300, -1e300)));
+    odd.resize(interleaved.size() + 6);
+    write_file(path, bytes(odd));
+    skipped = read_coord_stats(path, CoordLayout::interleaved, pool, options);
+    REQUIRE(skipped.count == n);
+    REQUIRE(skipped.bounds.value() == env);
+    REQUIRE(skipped.x_hist == a.x_hist);
+
+    write_file(path, "");
+    auto empty = read_coord_stats(path, CoordLayout::interleaved, pool);
+    REQUIRE(empty.count == 0);
+    REQUIRE_FALSE(empty.bounds.has_value());
+    write_file(path, "12345");
+    REQUIRE_THROWS(read_coord_stats(path, CoordLayout::interleaved, pool));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("segment clipping", "[clip]") {
+    constexpr MBR<double> box{0, 0, 10, 10};
+    //diagonal segment whose envelope overlaps the box corner
+    static_assert(box.intersects(Pt<double>{9, 12}, Pt<double>{12, 9}));
+    static_assert(!box.intersects_segment(Pt<double>{9, 12}, Pt<double>{12, 9}));
+    static_assert(box.intersects_segment(Pt<double>{9, 11}, Pt<double>{11, 9}));
+    static_assert(box.intersects_segment(Pt<double>{2, 2}, Pt<double>{3, 3}));
+    static_assert(!box.intersects_segment(Pt<double>{-1, 5}, Pt<double>{-1, 6}));
+    static_assert(box.intersects_segment(Pt<double>{0, -5}, Pt<double>{0, 15}));
+    constexpr auto c = box.clip_segment(Pt<double>{-5, 5}, Pt<double>{15, 5}).value();
+    static_assert(c.first == Pt<double>{0, 5} && c.second == Pt<double>{10, 5});
+    constexpr auto inner = box.clip_segment(Pt<double>{1, 2}, Pt<double>{3, 4}).value();
+    static_assert(inner.first == Pt<double>{1, 2} && inner.second == Pt<double>{3, 4});
+    static_assert(!box.clip_segment(Pt<double>{11, 0}, Pt<double>{20, 5}).has_value());
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    static_assert(!box.intersects_segment(Pt<double>{nan, 5}, Pt<double>{5, 5}));
+    static_assert(!box.intersects_segment(Pt<double>{5, 5}, Pt<double>{5, nan}));
+
+    std::mt19937 gen(43);
+    std::uniform_real_distribution<double> u(-5, 15);
+    std::size_t n = 1001;
+    std::vector<double> x0(n), y0(n), x1(n), y1(n);
+    for (std::size_t i = 0; i < n; i++) {
+        x0[i] = u(gen), y0[i] = u(gen), x1[i] = u(gen), y1[i] = u(gen);
+    }
+    x1[3] = x0[3];
+    y1[4] = y0[4];
+    x0[5] = std::nan("");
+    std::vector<double> cx0(n), cy0(n), cx1(n), cy1(n);
+    std::vector<uint8_t> hits(n), tested(n);
+    auto count = clip_segments(box, x0.data(), y0.data(), x1.data(), y1.data(), n,
+                               cx0.data(), cy0.data(), cx1.data(), cy1.data(), hits.data());
+    REQUIRE(segments_intersect(box, x0.data(), y0.data(), x1.data(), y1.data(), n, tested.data()) == count);
+    REQUIRE(tested == hits);
+    REQUIRE(hits[5] == 0);
+
+    auto grown = MBR<double>{box}.expand_by_delta(1e-9, 1e-9);
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        Pt<double> a{x0[i], y0[i]}, b{x1[i], y1[i]};
+        auto clipped = box.clip_segment(a, b);
+        REQUIRE(clipped.has_value() == (hits[i] == 1));
+        expected += clipped.has_value();
+        if (clipped) {
+            REQUIRE(cx0[i] == Approx(clipped->first.x));
+            REQUIRE(cy0[i] == Approx(clipped->first.y));
+            REQUIRE(cx1[i] == Approx(clipped->second.x));
+            REQUIRE(cy1[i] == Approx(clipped->second.y));
+            REQUIRE(grown.contains(cx0[i], cy0[i]));
+            REQUIRE(grown.contains(cx1[i], cy1[i]));
+        }
+    }
+    REQUIRE(count == expected);
+    REQUIRE(count > 0);
+    REQUIRE(count < n);
+}
+
+TEST_CASE("polyline and ring clipping", "[clip]") {
+    MBR<double> box{0, 0, 10, 10};
+    Clipper<double> clipper;
+    std::vector<Pt<double>> out;
+    std::vector<std::size_t> offsets;
+    auto area = [](const std::vector<Pt<double>> &r) {
+        double a = 0;
+        for (std::size_t i = 0; i + 1 < r.size(); i++) {
+            a += r[i].x * r[i + 1].y - r[i + 1].x * r[i].y;
+        }
+        return std::abs(a) / 2;
+    };
+
+    //closed square overlapping the upper right corner
+    std::vector<Pt<double>> square{{5, 5}, {15, 5}, {15, 15}, {5, 15}, {5, 5}};
+    REQUIRE(clipper.ring(box, square, out));
+    REQUIRE(out.front() == out.back());
+    REQUIRE(area(out) == Approx(25));
+    for (auto &p : out) {
+        REQUIRE(box.contains(p.x, p.y));
+    }
+
+    //diamond larger than the box clips to the box corners cut off
+    std::vector<Pt<double>> diamond{{5, -5}, {15, 5}, {5, 15}, {-5, 5}, {5, -5}};
+    REQUIRE(clipper.ring(box, diamond, out));
+    REQUIRE(area(out) == Approx(100));
+
+    std::vector<Pt<double>> tri{{-5, -5}, {20, -5}, {-5, 20}, {-5, -5}};
+    REQUIRE(clipper.ring(box, tri, out));
+    REQUIRE(area(out) == Approx(100 - 25.0 / 2));
+
+    //fast paths
+    std::vector<Pt<double>> inner{{1, 1}, {2, 1}, {2, 2}, {1, 1}};
+    REQUIRE(clipper.ring(box, inner, out));
+    REQUIRE(out == inner);
+    std::vector<Pt<double>> far{{20, 20}, {30, 20}, {30, 30}, {20, 20}};
+    REQUIRE_FALSE(clipper.ring(box, far, out));
+    REQUIRE(out.empty());
+    //envelope overlaps but the ring misses the box
+    std::vector<Pt<double>> corner{{12, 9}, {12, 12}, {9, 12}, {12, 9}};
+    REQUIRE_FALSE(clipper.ring(box, corner, out));
+
+    //polyline going out and back in gives two parts
+    std::vector<Pt<double>> line{{1, 1}, {5, 5}, {5, 15}, {8, 15}, {8, 5}, {9, 2}, {20, 2}};
+    REQUIRE(clipper.polyline(box, line, out, offsets) == 2);
+    REQUIRE((offsets == std::vector<std::size_t>{0, 3, 7}));
+    REQUIRE((out[0] == Pt<double>{1, 1} && out[1] == Pt<double>{5, 5} && out[2] == Pt<double>{5, 10}));
+    REQUIRE((out[3] == Pt<double>{8, 10} && out[4] == Pt<double>{8, 5}));
+    REQUIRE((out[5] == Pt<double>{9, 2} && out[6] == Pt<double>{10, 2}));
+
+    //segment crossing the box with both ends outside
+    std::vector<Pt<double>> cross{{-5, 5}, {15, 5}};
+    REQUIRE(clipper.polyline(box, cross, out, offsets) == 1);
+    REQUIRE((out == std::vector<Pt<double>>{{0, 5}, {10, 5}}));
+    REQUIRE(clipper.polyline(box, corner, out, offsets) == 0);
+    REQUIRE(clipper.polyline(box, inner, out, offsets) == 1);
+    REQUIRE(out == inner);
+}
+
+TEST_CASE("ray casting", "[ray]") {
+    MBR<double> box{0, 0, 10, 10};
+    auto hit = ray_box(Ray<double>{{-5, 5}, {1, 0}}, box).value();
+    REQUIRE(hit.enter == 5);
+    REQUIRE(hit.exit == 15);
+    REQUIRE(ray_box(Ray<double>{{5, 5}, {0, -2}}, box).value().enter == 0);
+    REQUIRE_FALSE(ray_box(Ray<double>{{-5, 5}, {-1, 0}}, box).has_value());
+    REQUIRE_FALSE(ray_box(Ray<double>{{-5, 5}, {1, 0}, 4}, box).has_value());
+    REQUIRE_FALSE(ray_box(Ray<double>{{-5, 11}, {1, 0}}, box).has_value());
+    REQUIRE(ray_box(Ray<double>{{0, -5}, {0, 1}}, box).has_value());
+
+    auto boxes = random_boxes(1000, 47);
+    std::mt19937 gen(53);
+    std::uniform_real_distribution<double> u(-10, 110);
+    std::uniform_real_distribution<double> d(-1, 1);
+    std::vector<double> enter(boxes.size()), exit(boxes.size());
+    std::vector<uint8_t> hits(boxes.size());
+    Index<double> index(boxes, 8);
+    for (int r = 0; r < 20; r++) {
+        Ray<double> ray{{u(gen), u(gen)}, {d(gen), r % 7 == 0 ? 0.0 : d(gen)}, 80};
+        auto count = ray_boxes(ray, boxes.data(), boxes.size(), enter.data(), exit.data(), hits.data());
+        std::size_t expected = 0;
+        std::optional<RayItem> nearest;
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            auto h = ray_box(ray, boxes[i]);
+            REQUIRE(h.has_value() == (hits[i] == 1));
+            if (h) {
+                expected++;
+                REQUIRE(enter[i] == Approx(h->enter));
+                REQUIRE(exit[i] == Approx(h->exit));
+                if (!nearest || h->enter < nearest->hit.enter) {
+                    nearest = RayItem{i, *h};
+                }
+            }
+        }
+        REQUIRE(count == expected);
+
+        std::vector<uint64_t> cast;
+        double last = 0;
+        raycast(index, ray, [&](const RayItem &item) {
+            REQUIRE(item.hit.enter >= last);
+            last = item.hit.enter;
+            cast.push_back(item.id);
+            return true;
+        });
+        REQUIRE(cast.size() == expected);
+        auto first = first_hit(index, ray);
+        REQUIRE(first.has_value() == nearest.has_value());
+        if (first) {
+            REQUIRE(first->hit.enter == nearest->hit.enter);
+        }
+    }
+
+    //packet of rays against one box
+    std::size_t n = 37;
+    std::vector<double> ox(n), oy(n), dx(n), dy(n), pe(n), px(n);
+    std::vector<uint8_t> ph(n);
+    for (std::size_t i = 0; i < n; i++) {
+        ox[i] = u(gen) / 5, oy[i] = u(gen) / 5, dx[i] = d(gen), dy[i] = i % 5 ? d(gen) : 0;
+    }
+    auto count = rays_box(ox.data(), oy.data(), dx.data(), dy.data(), n, box,
+                          pe.data(), px.data(), ph.data());
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        auto h = ray_box(Ray<double>{{ox[i], oy[i]}, {dx[i], dy[i]}}, box);
+        REQUIRE(h.has_value() == (ph[i] == 1));
+        expected += h.has_value();
+        if (h) {
+            REQUIRE(pe[i] == Approx(h->enter));
+        }
+    }
+    REQUIRE(count == expected);
+
+    Index<double> walls(std::vector<MBR<double>>{{4, 0, 5, 10}, {20, 0, 21, 10}});
+    REQUIRE_FALSE(line_of_sight(walls, Pt<double>{0, 5}, Pt<double>{10, 5}));
+    REQUIRE(line_of_sight(walls, Pt<double>{6, 5}, Pt<double>{19, 5}));
+    REQUIRE(first_hit(walls, Ray<double>{{30, 5}, {-1, 0}})->id == 1);
+
+    //NaN origins miss, whether tested alone, in a batch or in a packet
+    auto nan = std::nan("");
+    REQUIRE_FALSE(ray_box(Ray<double>{{nan, 5}, {1, 0}}, box).has_value());
+    REQUIRE_FALSE(ray_box(Ray<double>{{5, nan}, {1, 1}}, box).has_value());
+    REQUIRE_FALSE(ray_box(Ray<double>{{-5, 5}, {0, 1}}, box).has_value());
+    REQUIRE(ray_boxes(Ray<double>{{nan, 50}, {1, 0.5}}, boxes.data(), boxes.size(),
+                      enter.data(), exit.data(), hits.data()) == 0);
+    std::fill(ox.begin(), ox.end(), nan);
+    REQUIRE(rays_box(ox.data(), oy.data(), dx.data(), dy.data(), n, box, pe.data(), px.data(), ph.data()) == 0);
+
+    //a visitor may cast again while a cast is running
+    std::size_t outer = 0, inner = 0;
+    raycast(walls, Ray<double>{{0, 5}, {1, 0}}, [&](const RayItem &) {
+        outer++;
+        raycast(walls, Ray<double>{{30, 5}, {-1, 0}}, [&](const RayItem &) {
+            inner++;
+            return true;
+        });
+        return true;
+    });
+    REQUIRE(outer == 2);
+    REQUIRE(inner == 4);
+
+    //a throwing visitor still hands the heap back for the next cast
+    auto &rays = QueryScratch::local().rays;
+    auto held = rays.capacity();
+    REQUIRE(held > 0);
+    REQUIRE_THROWS_AS(raycast(walls, Ray<double>{{0, 5}, {1, 0}}, [](const RayItem &) -> bool {
+        throw std::runtime_error("stop");
+    }), const std::runtime_error &);
+    REQUIRE(rays.capacity() == held);
+    REQUIRE(first_hit(walls.view(), Ray<double>{{0, 5}, {1, 0}}).has_value());
+}
+
+TEST_CASE("monotone chain index", "[chains]") {
+    std::mt19937 gen(59);
+    std::uniform_real_distribution<double> step(-1, 1.2);
+    std::vector<Pt<double>> line{{0, 0}};
+    for (int i = 0; i < 20000; i++) {
+        auto &p = line.back();
+        line.push_back({p.x + step(gen), p.y + (i % 50 == 0 ? 0.0 : step(gen))});
+    }
+    ChainIndex<double> index(line, 16);
+    REQUIRE(index.size() == line.size() - 1);
+    REQUIRE(index.chains.front().first == 0);
+    REQUIRE(index.chains.back().last == line.size() - 1);
+    bool monotone = true;
+    for (std::size_t c = 0; c < index.chains.size(); c++) {
+        auto &chain = index.chains[c];
+        monotone &= chain.last - chain.first <= 16;
+        monotone &= c == 0 || chain.first == index.chains[c - 1].last;
+        for (auto v = chain.first; v < chain.last; v++) {
+            monotone &= chain.xdir * (line[v + 1].x - line[v].x) >= 0;
+            monotone &= chain.box.contains(line[v].x, line[v].y);
+        }
+    }
+    REQUIRE(monotone);
+
+    auto extent = *bounds_of(line);
+    std::uniform_real_distribution<double> ux(extent.minx, extent.maxx), uy(extent.miny, extent.maxy);
+    for (int q = 0; q < 40; q++) {
+        auto x = ux(gen), y = uy(gen);
+        MBR<double> window{x, y, x + 20, y + 20};
+        std::vector<std::size_t> expected;
+        for (std::size_t s = 0; s + 1 < line.size(); s++) {
+            if (window.intersects_segment(line[s], line[s + 1])) {
+                expected.push_back(s);
+            }
+        }
+        REQUIRE(index.search(window) == expected);
+
+        Pt<double> a{x, y}, b{ux(gen), uy(gen)};
+        expected.clear();
+        for (std::size_t s = 0; s + 1 < line.size(); s++) {
+            if (chains::segments_cross(a, b, line[s], line[s + 1])) {
+                expected.push_back(s);
+            }
+        }
+        REQUIRE(index.intersecting(a, b) == expected);
+    }
+
+    REQUIRE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{2, 2}, Pt<double>{0, 2}, Pt<double>{2, 0}));
+    REQUIRE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{2, 0}, Pt<double>{1, 0}, Pt<double>{3, 0}));
+    REQUIRE_FALSE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{1, 0}, Pt<double>{2, 0}, Pt<double>{3, 0}));
+    REQUIRE_FALSE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{2, 2}, Pt<double>{3, 0}, Pt<double>{2, 1}));
+    //degenerate segments : a point is on the segment only if it lies on its line
+    REQUIRE_FALSE(chains::segments_cross(Pt<double>{1, 0}, Pt<double>{1, 0}, Pt<double>{0, 0}, Pt<double>{2, 2}));
+    REQUIRE(chains::segments_cross(Pt<double>{1, 1}, Pt<double>{1, 1}, Pt<double>{0, 0}, Pt<double>{2, 2}));
+    REQUIRE_FALSE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{2, 2}, Pt<double>{2, 1}, Pt<double>{2, 1}));
+    REQUIRE(chains::segments_cross(Pt<double>{0, 0}, Pt<double>{2, 2}, Pt<double>{2, 2}, Pt<double>{2, 2}));
+    REQUIRE(chains::segments_cross(Pt<double>{3, 4}, Pt<double>{3, 4}, Pt<double>{3, 4}, Pt<double>{3, 4}));
+    REQUIRE_FALSE(chains::segments_cross(Pt<double>{3, 4}, Pt<double>{3, 4}, Pt<double>{4, 3}, Pt<double>{4, 3}));
+    REQUIRE(ChainIndex<double>(std::vector<Pt<double>>{{1, 1}}).search(MBR<double>{0, 0, 2, 2}).empty());
+}
+
+TEST_CASE("oriented bounding rectangles", "[obb]") {
+    std::mt19937 gen(23);
+    std::uniform_real_distribution<double> uw(-40, 40), uh(-10, 10);
+    //points scattered in a 80 x 20 rectangle turned 30 degrees about (100, 50)
+    auto c = std::cos(M_PI / 6), s = std::sin(M_PI / 6);
+    std::vector<Pt<double>> pts;
+    for (double u : {-40.0, 40.0}) {
+        for (double v : {-10.0, 10.0}) {
+            pts.push_back({100 + u * c - v * s, 50 + u * s + v * c});
+        }
+    }
+    for (int i = 0; i < 20000; i++) {
+        auto u = uw(gen), v = uh(gen);
+        pts.push_back({100 + u * c - v * s, 50 + u * s + v * c});
+    }
+
+    auto hull = convex_hull(pts);
+    REQUIRE(hull.size() == 4);
+    bool ccw = true;
+    for (std::size_t i = 0; i < hull.size(); i++) {
+        ccw &= obb::cross(hull[i], hull[(i + 1) % 4], hull[(i + 2) % 4]) > 0;
+    }
+    REQUIRE(ccw);
+
+    auto rect = *min_area_rect(pts);
+    REQUIRE(std::abs(rect.area() - 1600) < 1e-6);
+    REQUIRE(std::abs(std::max(rect.width, rect.height) - 80) < 1e-6);
+    REQUIRE(std::abs(rect.center.x - 100) < 1e-6);
+    REQUIRE(std::abs(rect.center.y - 50) < 1e-6);
+    REQUIRE(std::abs(std::sin(2 * rect.angle()) - std::sin(M_PI / 3)) < 1e-6);
+    bool inside = true;
+    for (auto &p : pts) {
+        inside &= rect.contains(p.x, p.y, 1e-6);
+    }
+    REQUIRE(inside);
+    REQUIRE(rect.area() < (*bounds_of(pts)).area());
+    REQUIRE(rect.envelope().contains(*bounds_of(pts)));
+
+    ThreadPool pool(4);
+    auto par = convex_hull(pts, pool, 1000);
+    REQUIRE(par.size() == hull.size());
+    bool same = true;
+    for (std::size_t i = 0; i < hull.size(); i++) {
+        same &= par[i].x == hull[i].x && par[i].y == hull[i].y;
+    }
+    REQUIRE(same);
+    REQUIRE(std::abs(min_area_rect(pts, pool)->area() - 1600) < 1e-6);
+    REQUIRE(std::abs(min_perimeter_rect(pts, pool)->perimeter() - 200) < 1e-6);
+    REQUIRE(std::abs(min_area_rect(pts.data(), pts.size(), pool, 512)->area() - 1600) < 1e-6);
+    REQUIRE(std::abs(min_perimeter_rect(pts.data(), pts.size(), pool, 512)->perimeter() - 200) < 1e-6);
+
+    //non-finite points are dropped before sorting
+    auto dirty = pts;
+    auto nan = std::nan(""), inf = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < dirty.size(); i += 97) {
+        dirty[i] = i % 2 ? Pt<double>{nan, 50} : Pt<double>{100, -inf};
+    }
+    dirty.insert(dirty.end(), pts.begin(), pts.begin() + 4);
+    REQUIRE(std::abs(min_area_rect(dirty)->area() - 1600) < 1e-6);
+    REQUIRE(std::abs(min_area_rect(dirty, pool, 1000)->area() - 1600) < 1e-6);
+    REQUIRE_FALSE(min_area_rect(std::vector<Pt<double>>{{nan, nan}, {inf, 0}}).has_value());
+
+    //random cloud : both answers beat every hull edge by brute force
+    std::uniform_real_distribution<double> ux(0, 100);
+    std::vector<Pt<double>> cloud(500);
+    for (auto &p : cloud) {
+        p = {ux(gen), ux(gen) * 0.3 + p.x};
+    }
+    for (auto &p : cloud) {
+        p.y += ux(gen) * 0.3;
+    }
+    hull = convex_hull(cloud);
+    double best_area = std::numeric_limits<double>::infinity(), best_perimeter = best_area;
+    for (std::size_t i = 0; i < hull.size(); i++) {
+        auto &p = hull[i], &q = hull[(i + 1) % hull.size()];
+        auto len = std::hypot(q.x - p.x, q.y - p.y);
+        auto dx = (q.x - p.x) / len, dy = (q.y - p.y) / len;
+        double lo = 0, hi = 0, top = 0;
+        for (auto &r : hull) {
+            auto u = (r.x - p.x) * dx + (r.y - p.y) * dy;
+            auto v = -(r.x - p.x) * dy + (r.y - p.y) * dx;
+            lo = std::min(lo, u);
+            hi = std::max(hi, u);
+            top = std::max(top, v);
+        }
+        best_area = std::min(best_area, (hi - lo) * top);
+        best_perimeter = std::min(best_perimeter, 2 * (hi - lo + top));
+    }
+    REQUIRE(std::abs(min_area_rect(cloud)->area() - best_area) < 1e-6);
+    REQUIRE(std::abs(min_perimeter_rect(cloud)->perimeter() - best_perimeter) < 1e-6);
+
+    REQUIRE_FALSE(min_area_rect(std::vector<Pt<double>>{}).has_value());
+    REQUIRE(min_area_rect(std::vector<Pt<double>>{{3, 4}})->area() == 0);
+    auto flat = *min_area_rect(std::vector<Pt<double>>{{0, 0}, {1, 1}, {3, 3}});
+    REQUIRE(flat.area() == 0);
+    REQUIRE(std::abs(flat.width - std::sqrt(18.0)) < 1e-12);
+}
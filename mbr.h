@@ -2,10 +2,14 @@
 #include <cassert>
 #include <array>
 #include <vector>
-#include <sstream>
+#include <string>
+#include <charconv>
+#include <utility>
+#include <limits>
 #include <optional>
-#include <iomanip>
 #include <functional>
+#include <system_error>
+#include <type_traits>
 
 #include "include/mutil.h"
 #include "include/pt.h"
@@ -13,50 +17,101 @@
 #ifndef MBR_MBR_H
 #define MBR_MBR_H
 namespace mbr {
+    ///Upper bound of the length of a single wkt polygon written by
+    ///MBR<T>::wkt : fixed notation spells out every digit from max()
+    ///down to denorm_min, so the bound follows the exponent range of T
     template<typename T>
-    struct MBR {
+    constexpr std::size_t wkt_max_len() {
+        using L = std::numeric_limits<T>;
+        static_assert(L::is_specialized, "wkt needs numeric coordinates");
+        std::size_t coord = L::digits10 + 2;
+        if constexpr (!L::is_integer) {
+            std::size_t whole = L::max_exponent10 + 1;
+            std::size_t frac = 2 * L::max_digits10 - L::min_exponent10;
+            coord = 3 + (whole > frac ? whole : frac);
+        }
+        //"POLYGON ((" + 5 points + 4 ", " + "))"
+        return 10 + 5 * (2 * coord + 1) + 8 + 2;
+    }
+
+    namespace clip {
+        ///Liang-Barsky on one axis, for one segment (V = T) or a vector
+        ///of segments : narrows [t0, t1] to where p0 + t * d lies in
+        ///[lo, hi], which may be scalars or vectors too. Branch free; a
+        ///segment parallel to the axis and outside the slab, or with a
+        ///NaN coordinate, is rejected by pushing t0 to infinity and t1 to
+        ///minus infinity, so it stays rejected on an unbounded ray. Shared
+        ///by MBR::clip_segment and the batch clippers of clip.h and ray.h.
+        template<typename T, typename V, typename L>
+        constexpr void slab(V p0, V d, L lo, L hi, V &t0, V &t1) {
+            V zero{};
+            V inf = zero + std::numeric_limits<T>::infinity();
+            auto flat = d == zero;
+            //no division by zero, so the scalar kernel stays usable in constant expressions
+            V step = flat ? zero + 1 : d;
+            V a = (lo - p0) / step;
+            V b = (hi - p0) / step;
+            V near = a < b ? a : b;
+            V far = a < b ? b : a;
+            auto inside = (p0 >= lo) & (p0 <= hi);
+            near = flat ? -inf : near;
+            far = flat ? inf : far;
+            auto reject = (flat & !inside) | (d != d) | (p0 != p0);
+            near = reject ? inf : near;
+            far = reject ? -inf : far;
+            t0 = near > t0 ? near : t0;
+            t1 = far < t1 ? far : t1;
+        }
+    }
+
+    ///Axis aligned box in D dimensions, MBR<T> is the 2D box
+    template<typename T, std::size_t D = 2>
+    struct MBR;
+
+    template<typename T>
+    struct MBR<T, 2> {
         T minx;
         T miny;
         T maxx;
         T maxy;
 
-        MBR() : minx(0), miny(0), maxx(0), maxy(0) {}
+        constexpr MBR() : minx(0), miny(0), maxx(0), maxy(0) {}
 
-        MBR(T minx, T miny, T maxx, T maxy) :
+        constexpr MBR(T minx, T miny, T maxx, T maxy) :
                 minx(min(minx, maxx)), miny(min(miny, maxy)),
                 maxx(max(minx, maxx)), maxy(max(miny, maxy)) {}
 
-        MBR(T minx_, T miny_, T maxx_, T maxy_, bool raw) :
+        constexpr MBR(T minx_, T miny_, T maxx_, T maxy_, bool raw) :
                 minx(raw ? minx_ : min(minx_, maxx_)),
                 miny(raw ? miny_ : min(miny_, maxy_)),
                 maxx(raw ? maxx_ : max(minx_, maxx_)),
                 maxy(raw ? maxy_ : max(miny_, maxy_)) {
         }
 
-        explicit MBR(const std::array<T, 4> &bounds) :
+        constexpr explicit MBR(const std::array<T, 4> &bounds) :
                 minx(min(bounds[0], bounds[2])),
                 miny(min(bounds[1], bounds[3])),
                 maxx(max(bounds[0], bounds[2])),
                 maxy(max(bounds[1], bounds[3])) {
         }
 
-        explicit MBR(const Pt<T> &pt) :
+        constexpr explicit MBR(const Pt<T> &pt) :
                 minx(pt.x),
                 miny(pt.y),
                 maxx(pt.x),
                 maxy(pt.y) {
         }
 
-        MBR(const Pt<T> &a, const Pt<T> &b) {
-            *this = MBR(a.x, a.y, b.x, b.y);
+        constexpr MBR(const Pt<T> &a, const Pt<T> &b) :
+                MBR(a.x, a.y, b.x, b.y) {
         }
 
-        MBR(const std::array<T, 4> &bounds, bool raw) {
-            *this = MBR(bounds[0], bounds[1], bounds[2], bounds[3], raw);
+        constexpr MBR(const std::array<T, 4> &bounds, bool raw) :
+                MBR(bounds[0], bounds[1], bounds[2], bounds[3], raw) {
         }
 
         template<typename U>
-        MBR<U> as() {
+        constexpr MBR<U> as() const {
             auto bounds = *this;
             return MBR<U>{
                     static_cast<U>(bounds.minx),
@@ -66,7 +121,7 @@ namespace mbr {
                     true};
         }
 
-        bool operator<(const MBR<T> &other) {
+        constexpr bool operator<(const MBR<T> &other) const {
             auto d = minx - other.minx;
             if (feq(d, 0)) {
                 d = miny - other.miny;
@@ -75,19 +130,19 @@ namespace mbr {
         }
 
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        MBR<T> &bbox() { return *this; }
+        constexpr MBR<T> &bbox() { return *this; }
 
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        MBR<T> clone() { return *this; }
+        constexpr MBR<T> clone() const { return *this; }
 
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        inline T width() const { return maxx - minx; }
+        constexpr T width() const { return maxx - minx; }
 
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        inline T height() const { return maxy - miny; }
+        constexpr T height() const { return maxy - miny; }
 
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        inline T area() const { return height() * width(); }
+        constexpr T area() const { return height() * width(); }
 
         std::vector<Pt<T>> as_poly_array() {
             return {
@@ -99,23 +154,23 @@ namespace mbr {
             };
         }
 
-        std::array<T, 4> as_array() const {
+        constexpr std::array<T, 4> as_array() const {
             return std::array<T, 4>{minx, miny, maxx, maxy};
         }
 
-        std::tuple<T, T, T, T> as_tuple() {
+        constexpr std::tuple<T, T, T, T> as_tuple() const {
             return std::tuple<T, T, T, T>{
                     minx, miny, maxx, maxy
             };
         }
 
-        std::pair<Pt<T>, Pt<T>> llur() {
-            return std::make_pair<Pt<T>, Pt<T>>({minx, miny}, {maxx, maxy});
+        constexpr std::pair<Pt<T>, Pt<T>> llur() const {
+            return {Pt<T>{minx, miny}, Pt<T>{maxx, maxy}};
         }
 
         ///Compare equality of two minimum bounding box
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        bool equals(const MBR<T> &other) const {
+        constexpr bool equals(const MBR<T> &other) const {
             return eqls(maxx, other.maxx) &&
                    eqls(maxy, other.maxy) &&
                    eqls(minx, other.minx) &&
@@ -125,13 +180,13 @@ namespace mbr {
         ///Checks if bounding box can be represented as a point,
         /// has both width and height as 0.
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        bool is_point() const {
+        constexpr bool is_point() const {
             return feq(height(), 0) && feq(width(), 0);
         }
 
         ///Contains bonding box
         ///is true if mbr completely contains other, boundaries may touch
-        bool contains(const MBR<T> &other) const {
+        constexpr bool contains(const MBR<T> &other) const {
             return (other.minx >= minx) &&
                    (other.miny >= miny) &&
                    (other.maxx <= maxx) &&
@@ -140,7 +195,7 @@ namespace mbr {
 
         ///contains x, y
         [[using gnu : const, always_inline, hot]] [[nodiscard]]
-        bool contains(T x, T y) const {
+        constexpr bool contains(T x, T y) const {
             return (x >= minx) &&
                    (x <= maxx) &&
                    (y >= miny) &&
@@ -150,7 +205,7 @@ namespace mbr {
         ///Completely contains bonding box
         ///is true if mbr completely contains other
         /// without touching boundary
-        bool completely_contains(const MBR<T> &other) const {
+        constexpr bool completely_contains(const MBR<T> &other) const {
             return (other.minx > minx) &&
                    (other.miny > miny) &&
                    (other.maxx < maxx) &&
@@ -159,7 +214,7 @@ namespace mbr {
 
         ///completely_contains_xy is true if mbr completely
         /// contains location with {x, y} without touching boundary
-        bool completely_contains(T x, T y) const {
+        constexpr bool completely_contains(T x, T y) const {
             return (x > minx) &&
                    (x < maxx) &&
                    (y > miny) &&
@@ -167,19 +222,19 @@ namespace mbr {
         }
 
         ///Create new bounding box by translating by dx and dy.
-        MBR<T> translate(T dx, T dy) const {
+        constexpr MBR<T> translate(T dx, T dy) const {
             return {minx + dx, miny + dy, maxx + dx, maxy + dy};
         }
 
         ///Computes the center of minimum bounding box - (x, y)
-        Pt<T> center() const {
+        constexpr Pt<T> center() const {
             auto d = static_cast<T>(2);
             return Pt<T>{(minx + maxx) / d, (miny + maxy) / d};
         }
 
         ///Checks if bounding box intersects other
         [[using gnu : const, always_inline, hot]]
-        inline bool intersects(const MBR<T> &other) const {
+        constexpr bool intersects(const MBR<T> &other) const {
             //not disjoint
             return !(other.minx > maxx ||
                      other.maxx < minx ||
@@ -189,13 +244,13 @@ namespace mbr {
 
         ///intersects point
         [[using gnu : const, always_inline, hot]]
-        bool intersects(T x, T y) const {
+        constexpr bool intersects(T x, T y) const {
             return contains(x, y);
         }
 
         ///intersects point
         [[using gnu : const, always_inline, hot]]
-        bool intersects(const Pt<T> &pt1, const Pt<T> &pt2) const {
+        constexpr bool intersects(const Pt<T> &pt1, const Pt<T> &pt2) const {
             auto minq = min(pt1.x, pt2.x);
             auto maxq = max(pt1.x, pt2.x);
 
@@ -210,14 +265,35 @@ namespace mbr {
             return !(miny > maxq || maxy < minq);
         }
 
+        ///Exact test of segment a b against the box (Liang-Barsky),
+        ///unlike intersects(pt1, pt2) which tests the segment envelope
+        constexpr bool intersects_segment(const Pt<T> &a, const Pt<T> &b) const {
+            double t0 = 0, t1 = 1;
+            return clip_params(a, b, t0, t1);
+        }
+
+        ///Part of segment a b inside the box (Liang-Barsky), empty if
+        ///the segment misses the box
+        constexpr std::optional<std::pair<Pt<T>, Pt<T>>> clip_segment(const Pt<T> &a, const Pt<T> &b) const {
+            double t0 = 0, t1 = 1;
+            if (!clip_params(a, b, t0, t1)) {
+                return std::nullopt;
+            }
+            auto dx = static_cast<double>(b.x) - a.x, dy = static_cast<double>(b.y) - a.y;
+            auto at = [&](double t) {
+                return t == 0 ? a : t == 1 ? b : Pt<T>{static_cast<T>(a.x + t * dx), static_cast<T>(a.y + t * dy)};
+            };
+            return std::pair<Pt<T>, Pt<T>>{at(t0), at(t1)};
+        }
+
         ///Test for disjoint between two mbrs
         [[using gnu : const, always_inline, hot]]
-        bool disjoint(const MBR<T> &other) const {
+        constexpr bool disjoint(const MBR<T> &other) const {
             return !intersects(other);
         }
 
         ///Computes the intersection of two bounding box
-        std::optional<MBR<T>> intersection(const MBR<T> &other) const{
+        constexpr std::optional<MBR<T>> intersection(const MBR<T> &other) const {
             if (disjoint(other)) {
                 return std::nullopt;
             }
@@ -230,7 +306,7 @@ namespace mbr {
 
 
         ///Expand include other bounding box
-        MBR<T> &expand_to_include(const MBR<T> &other) {
+        constexpr MBR<T> &expand_to_include(const MBR<T> &other) {
             minx = min(other.minx, minx);
             miny = min(other.miny, miny);
 
@@ -240,26 +316,18 @@ namespace mbr {
         }
 
 
-        ///Expand to include x,y
-        MBR<T> &expand_to_include(T x, T y) {
-            if (x < minx) {
-                minx = x;
-            }
-            else if (x > maxx) {
-                maxx = x;
-            }
-
-            if (y < miny) {
-                miny = y;
-            }
-            else if (y > maxy) {
-                maxy = y;
-            }
+        ///Expand to include x,y; min and max update independently
+        ///as selects so loops over points vectorize
+        constexpr MBR<T> &expand_to_include(T x, T y) {
+            minx = x < minx ? x : minx;
+            maxx = x > maxx ? x : maxx;
+            miny = y < miny ? y : miny;
+            maxy = y > maxy ? y : maxy;
             return *this;
         }
 
         ///Expand by delta in x and y
-        MBR<T> &expand_by_delta(T dx, T dy) {
+        constexpr MBR<T> &expand_by_delta(T dx, T dy) {
             auto minx_ = minx - dx, miny_ = miny - dy;
             auto maxx_ = maxx + dx, maxy_ = maxy + dy;
 
@@ -273,7 +341,7 @@ namespace mbr {
 
 
         ///computes dx and dy for computing hypot
-        Pt<T> distance_dxdy(const MBR<T> &other) const {
+        constexpr Pt<T> distance_dxdy(const MBR<T> &other) const {
             T dx{0};
             T dy{0};
 
@@ -308,7 +376,7 @@ namespace mbr {
 
         ///distance square computes the squared distance
         ///between bounding boxes
-        double distance_square(const MBR<T> &other) const {
+        constexpr double distance_square(const MBR<T> &other) const {
             if (intersects(other)) {
                 return 0.0;
             }
@@ -316,21 +384,42 @@ namespace mbr {
             return (o.x * o.x) + (o.y * o.y);
         }
 
+        ///WKT : writes wkt of mbr as polygon into [first, last),
+        ///coordinates use the shortest round-trip representation
+        std::to_chars_result wkt(char *first, char *last) const {
+            const T xs[] = {minx, minx, maxx, maxx, minx};
+            const T ys[] = {miny, maxy, maxy, miny, miny};
+            auto res = put(first, last, "POLYGON ((");
+            for (int i = 0; i < 5 && res.ec == std::errc{}; i++) {
+                if (i > 0) {
+                    res = put(res.ptr, last, ", ");
+                }
+                res = put(res.ptr, last, xs[i]);
+                res = put(res.ptr, last, " ");
+                res = put(res.ptr, last, ys[i]);
+            }
+            return put(res.ptr, last, "))");
+        }
+
+        ///WKT : appends wkt of mbr as polygon to out
+        void wkt(std::string &out) const {
+            char buf[wkt_max_len<T>()];
+            auto res = wkt(buf, buf + sizeof(buf));
+            if (res.ec != std::errc{}) {
+                throw std::system_error(std::make_error_code(res.ec), "wkt");
+            }
+            out.append(buf, res.ptr);
+        }
+
         ///WKT : wkt string of mbr as polygon
         [[nodiscard]] std::string wkt() const {
-            std::ostringstream ss;
-            ss << "POLYGON (("
-               << f2str(minx) << " " << f2str(miny) << ", "
-               << f2str(minx) << " " << f2str(maxy) << ", "
-               << f2str(maxx) << " " << f2str(maxy) << ", "
-               << f2str(maxx) << " " << f2str(miny) << ", "
-               << f2str(minx) << " " << f2str(miny)
-               << "))";
-            return ss.str();
+            std::string s;
+            wkt(s);
+            return s;
         }
 
         ///Operator : + : Union
-        MBR<T> operator+(const MBR<T> &other) const {
+        constexpr MBR<T> operator+(const MBR<T> &other) const {
             return {
                     min(other.minx, minx),
                     min(other.miny, miny),
@@ -341,60 +430,93 @@ namespace mbr {
         }
 
         ///Operator : | or + : Union
-        MBR<T> operator|(const MBR<T> &other) const {
+        constexpr MBR<T> operator|(const MBR<T> &other) const {
             return *this + other;
         }
 
         ///Operator : & : intersection
-        std::optional<MBR<T>> operator&(const MBR<T> &other) const {
+        constexpr std::optional<MBR<T>> operator&(const MBR<T> &other) const {
             return intersection(other);
         }
 
         ///Operator : equals
-        inline bool operator==(const MBR<T> &other) {
+        constexpr bool operator==(const MBR<T> &other) const {
             return equals(other);
         }
 
         ///Operator : not equal
-        bool operator!=(const MBR<T> &other) {
+        constexpr bool operator!=(const MBR<T> &other) const {
             return !(this->equals(other));
         }
 
     private:
-        [[nodiscard]] std::string f2str(double f, int precision = 12) const {
-            std::stringstream ss;
-            ss << std::fixed << std::setprecision(precision) << f;
-            auto s = ss.str();
-            s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-            if (s.back() == '.') {
-                s.pop_back();
+        ///Narrows [t0, t1] of segment a b to the part inside the box;
+        ///false if nothing is left
+        constexpr bool clip_params(const Pt<T> &a, const Pt<T> &b, double &t0, double &t1) const {
+            auto dx = static_cast<double>(b.x) - a.x, dy = static_cast<double>(b.y) - a.y;
+            clip::slab<double>(static_cast<double>(a.x), dx,
+                               static_cast<double>(minx), static_cast<double>(maxx), t0, t1);
+            clip::slab<double>(static_cast<double>(a.y), dy,
+                               static_cast<double>(miny), static_cast<double>(maxy), t0, t1);
+            return t0 <= t1;
+        }
+
+        static std::to_chars_result put(char *first, char *last, T v) {
+            if constexpr (std::is_integral<T>::value) {
+                return std::to_chars(first, last, v);
             }
-            return s;
+            else {
+                return std::to_chars(first, last, v, std::chars_format::fixed);
+            }
+        }
+
+        static std::to_chars_result put(char *first, char *last, const char *lit) {
+            for (; *lit != '\0'; lit++) {
+                if (first == last) {
+                    return {last, std::errc::value_too_large};
+                }
+                *first++ = *lit;
+            }
+            return {first, std::errc{}};
         }
 
+        ///min and max keep the fmin / fmax behaviour of ignoring a NaN
+        ///operand while staying usable in constant expressions
         template<typename U>
-        U min(U a, U b) const {
+        static constexpr U min(U a, U b) {
             if constexpr (std::is_integral<T>::value) {
                 return b < a ? b : a;
             }
             else {
-                return std::fmin(a, b);
+                if (a != a) {
+                    return b;
+                }
+                if (b != b) {
+                    return a;
+                }
+                return b < a ? b : a;
             };
         }
 
         template<typename U>
-        U max(U a, U b) const {
+        static constexpr U max(U a, U b) {
             if constexpr (std::is_integral<T>::value) {
                 return b > a ? b : a;
             }
             else {
-                return std::fmax(a, b);
+                if (a != a) {
+                    return b;
+                }
+                if (b != b) {
+                    return a;
+                }
+                return b > a ? b : a;
             };
         }
 
 
         template<typename U>
-        bool eqls(U a, U b) const {
+        static constexpr bool eqls(U a, U b) {
             if constexpr (std::is_integral<T>::value) {
                 return a == b;
             }
@@ -404,5 +526,249 @@ namespace mbr {
         }
 
     };
+
+    ///Smallest power of two holding d lanes
+    constexpr std::size_t pow2_lanes(std::size_t d) {
+        std::size_t lanes = 1;
+        while (lanes < d) {
+            lanes *= 2;
+        }
+        return lanes;
+    }
+
+    ///Box in D dimensions as lower and upper corners. Corners are padded
+    ///to a power of two lanes (3 -> 4, 5 -> 8) and aligned up to a cache
+    ///line, padding lanes stay 0 so they never change a predicate, and
+    ///every per axis operation is an unrolled loop over all lanes the
+    ///compiler can keep in registers.
+    template<typename T, std::size_t D>
+    struct MBR {
+        static_assert(D > 0, "box needs at least one dimension");
+
+        static constexpr std::size_t DIM = D;
+        static constexpr std::size_t LANES = pow2_lanes(D);
+
+        alignas(LANES * sizeof(T) < 64 ? LANES * sizeof(T) : 64)
+        std::array<T, LANES> lo{};
+        std::array<T, LANES> hi{};
+
+        constexpr MBR() = default;
+
+        ///Box with corners a and b, in any order
+        constexpr MBR(const std::array<T, D> &a, const std::array<T, D> &b) {
+            for (std::size_t i = 0; i < D; i++) {
+                lo[i] = a[i] < b[i] ? a[i] : b[i];
+                hi[i] = a[i] < b[i] ? b[i] : a[i];
+            }
+        }
+
+        ///Degenerate box of a point
+        constexpr explicit MBR(const std::array<T, D> &pt) : MBR(pt, pt) {}
+
+        template<std::size_t E = D, typename = std::enable_if_t<E == 3>>
+        constexpr MBR(T minx, T miny, T minz, T maxx, T maxy, T maxz) :
+                MBR(std::array<T, 3>{minx, miny, minz}, std::array<T, 3>{maxx, maxy, maxz}) {}
+
+        template<std::size_t E = D, typename = std::enable_if_t<E == 3>>
+        constexpr MBR(const Pt3d<T> &a, const Pt3d<T> &b) :
+                MBR(a.as_array(), b.as_array()) {}
+
+        template<std::size_t E = D, typename = std::enable_if_t<E == 3>>
+        constexpr explicit MBR(const Pt3d<T> &pt) : MBR(pt, pt) {}
+
+        ///2D box extruded over [minz, maxz]
+        template<std::size_t E = D, typename = std::enable_if_t<E == 3>>
+        constexpr MBR(const MBR<T, 2> &xy, T minz, T maxz) :
+                MBR(xy.minx, xy.miny, minz, xy.maxx, xy.maxy, maxz) {}
+
+        ///Lower corner
+        constexpr std::array<T, D> min_corner() const {
+            std::array<T, D> out{};
+            for (std::size_t i = 0; i < D; i++) {
+                out[i] = lo[i];
+            }
+            return out;
+        }
+
+        ///Upper corner
+        constexpr std::array<T, D> max_corner() const {
+            std::array<T, D> out{};
+            for (std::size_t i = 0; i < D; i++) {
+                out[i] = hi[i];
+            }
+            return out;
+        }
+
+        ///Extent along axis
+        constexpr T extent(std::size_t axis) const {
+            return hi[axis] - lo[axis];
+        }
+
+        ///Product of the extents, the area of a 2D box
+        constexpr T volume() const {
+            T v{1};
+            for (std::size_t i = 0; i < D; i++) {
+                v *= extent(i);
+            }
+            return v;
+        }
+
+        ///Center
+        constexpr std::array<T, D> center() const {
+            std::array<T, D> out{};
+            for (std::size_t i = 0; i < D; i++) {
+                out[i] = (lo[i] + hi[i]) / 2;
+            }
+            return out;
+        }
+
+        ///Projection on the x and y axes
+        template<std::size_t E = D, typename = std::enable_if_t<(E >= 2)>>
+        constexpr MBR<T, 2> as_2d() const {
+            return MBR<T, 2>{lo[0], lo[1], hi[0], hi[1], true};
+        }
+
+        ///Is degenerate : a point
+        constexpr bool is_point() const {
+            return all([&](std::size_t i) { return eqls(lo[i], hi[i]); });
+        }
+
+        ///Checks if bounding boxes are equal
+        constexpr bool equals(const MBR &other) const {
+            return all([&](std::size_t i) {
+                return eqls(lo[i], other.lo[i]) && eqls(hi[i], other.hi[i]);
+            });
+        }
+
+        ///Checks if bounding boxes share a point
+        constexpr bool intersects(const MBR &other) const {
+            return all([&](std::size_t i) { return lo[i] <= other.hi[i] && other.lo[i] <= hi[i]; });
+        }
+
+        ///Checks if bounding boxes share no point
+        constexpr bool disjoint(const MBR &other) const {
+            return !intersects(other);
+        }
+
+        ///Contains other bounding box, boundaries included
+        constexpr bool contains(const MBR &other) const {
+            return all([&](std::size_t i) { return lo[i] <= other.lo[i] && other.hi[i] <= hi[i]; });
+        }
+
+        ///Contains point, boundaries included
+        constexpr bool contains(const std::array<T, D> &pt) const {
+            return contains(MBR(pt));
+        }
+
+        template<std::size_t E = D, typename = std::enable_if_t<E == 3>>
+        constexpr bool contains(const Pt3d<T> &pt) const {
+            return contains(MBR(pt));
+        }
+
+        ///Intersection of bounding boxes, empty if disjoint
+        constexpr std::optional<MBR> intersection(const MBR &other) const {
+            if (!intersects(other)) {
+                return std::nullopt;
+            }
+            MBR out;
+            for (std::size_t i = 0; i < LANES; i++) {
+                out.lo[i] = lo[i] < other.lo[i] ? other.lo[i] : lo[i];
+                out.hi[i] = hi[i] < other.hi[i] ? hi[i] : other.hi[i];
+            }
+            return out;
+        }
+
+        ///Expand include other bounding box
+        constexpr MBR &expand_to_include(const MBR &other) {
+            for (std::size_t i = 0; i < LANES; i++) {
+                lo[i] = other.lo[i] < lo[i] ? other.lo[i] : lo[i];
+                hi[i] = other.hi[i] > hi[i] ? other.hi[i] : hi[i];
+            }
+            return *this;
+        }
+
+        ///Expand to include point
+        constexpr MBR &expand_to_include(const std::array<T, D> &pt) {
+            return expand_to_include(MBR(pt));
+        }
+
+        ///Expand by delta along every axis
+        constexpr MBR &expand_by_delta(T delta) {
+            for (std::size_t i = 0; i < D; i++) {
+                auto a = lo[i] - delta, b = hi[i] + delta;
+                lo[i] = a < b ? a : b;
+                hi[i] = a < b ? b : a;
+            }
+            return *this;
+        }
+
+        ///distance square computes the squared distance
+        ///between bounding boxes
+        constexpr double distance_square(const MBR &other) const {
+            double sum = 0;
+            for (std::size_t i = 0; i < LANES; i++) {
+                auto d = static_cast<double>(other.lo[i] - hi[i]);
+                auto e = static_cast<double>(lo[i] - other.hi[i]);
+                d = d > e ? d : e;
+                d = d > 0 ? d : 0;
+                sum += d * d;
+            }
+            return sum;
+        }
+
+        ///Distance computes the distance between two boxes
+        double distance(const MBR &other) const {
+            return std::sqrt(distance_square(other));
+        }
+
+        ///Operator : union of bounding boxes
+        constexpr MBR operator+(const MBR &other) const {
+            return MBR(*this).expand_to_include(other);
+        }
+
+        ///Operator : union of bounding boxes
+        constexpr MBR operator|(const MBR &other) const {
+            return *this + other;
+        }
+
+        ///Operator : intersection of bounding boxes
+        constexpr std::optional<MBR> operator&(const MBR &other) const {
+            return intersection(other);
+        }
+
+        ///Operator : equals
+        constexpr bool operator==(const MBR &other) const {
+            return equals(other);
+        }
+
+        ///Operator : not equal
+        constexpr bool operator!=(const MBR &other) const {
+            return !equals(other);
+        }
+
+    private:
+        ///Evaluates pred on every lane without branching between lanes
+        template<typename Pred>
+        static constexpr bool all(Pred &&pred) {
+            return all(pred, std::make_index_sequence<LANES>{});
+        }
+
+        template<typename Pred, std::size_t... I>
+        static constexpr bool all(Pred &pred, std::index_sequence<I...>) {
+            return (true & ... & static_cast<bool>(pred(I)));
+        }
+
+        static constexpr bool eqls(T a, T b) {
+            if constexpr (std::is_integral<T>::value) {
+                return a == b;
+            }
+            else {
+                return feq(a, b);
+            };
+        }
+    };
+
+    template<typename T>
+    using MBR3d = MBR<T, 3>;
 }
 #endif //MBR_MBR_H